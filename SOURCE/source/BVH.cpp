@@ -0,0 +1,451 @@
+// External includes
+#include <algorithm>
+#include <chrono>
+
+// Project includes
+#include "BVH.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int BIN_COUNT{ 16 };
+		constexpr uint32_t MAX_LEAF_PRIMITIVES{ 8 };
+		constexpr uint32_t MAX_DEPTH{ 60 };
+		constexpr float TRAVERSAL_COST{ 1.0f };
+		constexpr float INTERSECTION_COST{ 1.0f };
+
+		// A refitted tree is rebuilt once its SAH cost has grown this much compared to the last full build
+		constexpr float MAX_REFIT_DEGRADATION{ 1.4f };
+
+		struct Bin
+		{
+			Vector3 minAABB{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maxAABB{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			uint32_t primitiveCount{};
+		};
+
+		float MillisecondsSince(const std::chrono::high_resolution_clock::time_point& start)
+		{
+			return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+	BVH::BVH() :
+		nodes{},
+		primitiveIndices{},
+		buildCost{ 0.0f },
+		cost{ 0.0f },
+		lastBuildTime{ 0.0f },
+		lastRefitTime{ 0.0f },
+		refitCount{ 0 },
+		leafBatchSize{ 1 }
+	{
+
+	}
+
+	void BVH::Build(const std::vector<Vector3>& positions, const std::vector<int>& indices)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+		const size_t triangleCount{ indices.size() / 3 };
+
+		std::vector<Vector3> minBounds(triangleCount);
+		std::vector<Vector3> maxBounds(triangleCount);
+
+		for (size_t triangle{}; triangle < triangleCount; ++triangle)
+		{
+			const Vector3& v0{ positions[indices[triangle * 3]] };
+			const Vector3& v1{ positions[indices[triangle * 3 + 1]] };
+			const Vector3& v2{ positions[indices[triangle * 3 + 2]] };
+
+			minBounds[triangle] = Vector3::Min(v0, Vector3::Min(v1, v2));
+			maxBounds[triangle] = Vector3::Max(v0, Vector3::Max(v1, v2));
+		}
+
+		Build(minBounds, maxBounds);
+
+		lastBuildTime = MillisecondsSince(start);
+	}
+
+	void BVH::Build(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+		Clear();
+
+		const uint32_t primitiveCount{ static_cast<uint32_t>(minBounds.size()) };
+		if (primitiveCount == 0) return;
+
+		// Centroids are only needed while building
+		std::vector<Vector3> centroids(primitiveCount);
+		for (uint32_t primitive{}; primitive < primitiveCount; ++primitive) centroids[primitive] = (minBounds[primitive] + maxBounds[primitive]) * 0.5f;
+
+		primitiveIndices.resize(primitiveCount);
+		for (uint32_t primitive{}; primitive < primitiveCount; ++primitive) primitiveIndices[primitive] = primitive;
+
+		// A binary tree with N leaves never needs more than 2N - 1 nodes
+		nodes.reserve(size_t(primitiveCount) * 2);
+		nodes.emplace_back(BVHNode{ Vector3::Zero, Vector3::Zero, 0, primitiveCount });
+		UpdateNodeBounds(0, minBounds, maxBounds);
+
+		Subdivide(0, centroids, minBounds, maxBounds);
+
+		buildCost = CalculateCost();
+		cost = buildCost;
+		refitCount = 0;
+		lastBuildTime = MillisecondsSince(start);
+	}
+
+	void BVH::Refit(const std::vector<Vector3>& positions, const std::vector<int>& indices)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+
+		// Children are always stored after their parent, so walking the nodes backwards visits them bottom-up
+		for (size_t nodeIndex{ nodes.size() }; nodeIndex-- > 0;)
+		{
+			BVHNode& node{ nodes[nodeIndex] };
+
+			if (node.IsLeaf())
+			{
+				node.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+				node.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+				for (uint32_t index{ node.leftFirst }; index < node.leftFirst + node.primitiveCount; ++index)
+				{
+					const size_t triangle{ primitiveIndices[index] };
+
+					for (size_t vertex{}; vertex < 3; ++vertex)
+					{
+						node.minAABB = Vector3::Min(node.minAABB, positions[indices[triangle * 3 + vertex]]);
+						node.maxAABB = Vector3::Max(node.maxAABB, positions[indices[triangle * 3 + vertex]]);
+					}
+				}
+			}
+			else
+			{
+				RefitInteriorNode(node);
+			}
+		}
+
+		cost = CalculateCost();
+		++refitCount;
+		lastRefitTime = MillisecondsSince(start);
+	}
+
+	void BVH::Refit(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+
+		for (size_t nodeIndex{ nodes.size() }; nodeIndex-- > 0;)
+		{
+			if (nodes[nodeIndex].IsLeaf()) UpdateNodeBounds(uint32_t(nodeIndex), minBounds, maxBounds);
+			else RefitInteriorNode(nodes[nodeIndex]);
+		}
+
+		cost = CalculateCost();
+		++refitCount;
+		lastRefitTime = MillisecondsSince(start);
+	}
+
+	bool BVH::NeedsRebuild() const
+	{
+		return nodes.empty() || cost > buildCost * MAX_REFIT_DEGRADATION;
+	}
+
+	float BVH::CalculateCost() const
+	{
+		if (nodes.empty()) return 0.0f;
+
+		// Expected cost of a random ray through the root, the area of a node relative to the root is the chance it gets visited
+		float totalCost{ 0.0f };
+
+		for (const BVHNode& node : nodes)
+		{
+			const float area{ SurfaceArea(node.minAABB, node.maxAABB) };
+			totalCost += node.IsLeaf() ? (area * INTERSECTION_COST * BatchCount(node.primitiveCount)) : (area * TRAVERSAL_COST);
+		}
+
+		return totalCost / std::max(SurfaceArea(nodes[0].minAABB, nodes[0].maxAABB), FLT_EPSILON);
+	}
+
+	float BVH::BatchCount(uint32_t primitiveCount) const
+	{
+		return float((primitiveCount + leafBatchSize - 1) / leafBatchSize);
+	}
+
+	void BVH::Clear()
+	{
+		nodes.clear();
+		primitiveIndices.clear();
+	}
+
+	void BVH::Subdivide(uint32_t rootIndex, const std::vector<Vector3>& centroids, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		struct Task
+		{
+			uint32_t nodeIndex;
+			uint32_t depth;
+		};
+
+		std::vector<Task> tasks{ Task{ rootIndex, 0 } };
+
+		while (!tasks.empty())
+		{
+			const Task task{ tasks.back() };
+			tasks.pop_back();
+
+			BVHNode& node{ nodes[task.nodeIndex] };
+			if (node.primitiveCount <= 1 || task.depth >= MAX_DEPTH) continue;
+
+			// Bin the primitives on their centroids, the bounds of the primitives themselves are too loose to bin on
+			Vector3 minCentroid{ centroids[primitiveIndices[node.leftFirst]] };
+			Vector3 maxCentroid{ minCentroid };
+
+			for (uint32_t index{ node.leftFirst }; index < node.leftFirst + node.primitiveCount; ++index)
+			{
+				minCentroid = Vector3::Min(minCentroid, centroids[primitiveIndices[index]]);
+				maxCentroid = Vector3::Max(maxCentroid, centroids[primitiveIndices[index]]);
+			}
+
+			int bestAxis{ -1 };
+			int bestSplit{ 0 };
+			float bestCost{ FLT_MAX };
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float extent{ maxCentroid[axis] - minCentroid[axis] };
+				if (extent <= FLT_EPSILON) continue;
+
+				Bin bins[BIN_COUNT]{};
+				const float scale{ BIN_COUNT / extent };
+
+				for (uint32_t index{ node.leftFirst }; index < node.leftFirst + node.primitiveCount; ++index)
+				{
+					const uint32_t primitive{ primitiveIndices[index] };
+					const int binIndex{ std::min(BIN_COUNT - 1, int((centroids[primitive][axis] - minCentroid[axis]) * scale)) };
+
+					Bin& bin{ bins[binIndex] };
+					bin.minAABB = Vector3::Min(bin.minAABB, minBounds[primitive]);
+					bin.maxAABB = Vector3::Max(bin.maxAABB, maxBounds[primitive]);
+					++bin.primitiveCount;
+				}
+
+				// Sweep from both sides so every split plane is evaluated in linear time
+				float leftArea[BIN_COUNT - 1]{};
+				float rightArea[BIN_COUNT - 1]{};
+				uint32_t leftCount[BIN_COUNT - 1]{};
+				uint32_t rightCount[BIN_COUNT - 1]{};
+
+				Bin leftBox{};
+				Bin rightBox{};
+
+				for (int split{}; split < BIN_COUNT - 1; ++split)
+				{
+					leftBox.minAABB = Vector3::Min(leftBox.minAABB, bins[split].minAABB);
+					leftBox.maxAABB = Vector3::Max(leftBox.maxAABB, bins[split].maxAABB);
+					leftBox.primitiveCount += bins[split].primitiveCount;
+					leftCount[split] = leftBox.primitiveCount;
+					leftArea[split] = (leftBox.primitiveCount > 0) ? SurfaceArea(leftBox.minAABB, leftBox.maxAABB) : 0.0f;
+
+					const int mirrored{ BIN_COUNT - 1 - split };
+					rightBox.minAABB = Vector3::Min(rightBox.minAABB, bins[mirrored].minAABB);
+					rightBox.maxAABB = Vector3::Max(rightBox.maxAABB, bins[mirrored].maxAABB);
+					rightBox.primitiveCount += bins[mirrored].primitiveCount;
+					rightCount[mirrored - 1] = rightBox.primitiveCount;
+					rightArea[mirrored - 1] = (rightBox.primitiveCount > 0) ? SurfaceArea(rightBox.minAABB, rightBox.maxAABB) : 0.0f;
+				}
+
+				for (int split{}; split < BIN_COUNT - 1; ++split)
+				{
+					if (leftCount[split] == 0 || rightCount[split] == 0) continue;
+
+					const float cost{ leftArea[split] * BatchCount(leftCount[split]) + rightArea[split] * BatchCount(rightCount[split]) };
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = split;
+					}
+				}
+			}
+
+			if (bestAxis == -1) continue;
+
+			// Compare the split against simply keeping all primitives in this node
+			const float nodeArea{ SurfaceArea(node.minAABB, node.maxAABB) };
+			const float splitCost{ TRAVERSAL_COST + INTERSECTION_COST * bestCost / std::max(nodeArea, FLT_EPSILON) };
+			const float leafCost{ INTERSECTION_COST * BatchCount(node.primitiveCount) };
+
+			if (splitCost >= leafCost && node.primitiveCount <= MAX_LEAF_PRIMITIVES) continue;
+
+			// Partition the primitive indices of this node in place
+			const float extent{ maxCentroid[bestAxis] - minCentroid[bestAxis] };
+			const float scale{ BIN_COUNT / extent };
+			const float minimum{ minCentroid[bestAxis] };
+
+			auto first{ primitiveIndices.begin() + node.leftFirst };
+			auto last{ first + node.primitiveCount };
+			auto middle{ std::partition(first, last,
+				[&](uint32_t primitive)
+				{
+					return std::min(BIN_COUNT - 1, int((centroids[primitive][bestAxis] - minimum) * scale)) <= bestSplit;
+				}
+			) };
+
+			const uint32_t leftCount{ static_cast<uint32_t>(middle - first) };
+			if (leftCount == 0 || leftCount == node.primitiveCount) continue;
+
+			const uint32_t firstPrimitive{ node.leftFirst };
+			const uint32_t primitiveCount{ node.primitiveCount };
+			const uint32_t leftIndex{ static_cast<uint32_t>(nodes.size()) };
+
+			// Pushing the children can reallocate, so the node reference is not used past this point
+			nodes.emplace_back(BVHNode{ Vector3::Zero, Vector3::Zero, firstPrimitive, leftCount });
+			nodes.emplace_back(BVHNode{ Vector3::Zero, Vector3::Zero, firstPrimitive + leftCount, primitiveCount - leftCount });
+
+			nodes[task.nodeIndex].leftFirst = leftIndex;
+			nodes[task.nodeIndex].primitiveCount = 0;
+
+			UpdateNodeBounds(leftIndex, minBounds, maxBounds);
+			UpdateNodeBounds(leftIndex + 1, minBounds, maxBounds);
+
+			tasks.emplace_back(Task{ leftIndex, task.depth + 1 });
+			tasks.emplace_back(Task{ leftIndex + 1, task.depth + 1 });
+		}
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIndex, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		BVHNode& node{ nodes[nodeIndex] };
+		node.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+		node.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (uint32_t index{ node.leftFirst }; index < node.leftFirst + node.primitiveCount; ++index)
+		{
+			node.minAABB = Vector3::Min(node.minAABB, minBounds[primitiveIndices[index]]);
+			node.maxAABB = Vector3::Max(node.maxAABB, maxBounds[primitiveIndices[index]]);
+		}
+	}
+
+	void BVH::RefitInteriorNode(BVHNode& node)
+	{
+		const BVHNode& left{ nodes[node.leftFirst] };
+		const BVHNode& right{ nodes[node.leftFirst + 1] };
+
+		node.minAABB = Vector3::Min(left.minAABB, right.minAABB);
+		node.maxAABB = Vector3::Max(left.maxAABB, right.maxAABB);
+	}
+
+	WideBVH::WideBVH() :
+		nodes{},
+		minAABB{},
+		maxAABB{}
+	{
+
+	}
+
+	void WideBVH::Build(const BVH& bvh)
+	{
+		Clear();
+		if (bvh.nodes.empty()) return;
+
+		minAABB = bvh.nodes[0].minAABB;
+		maxAABB = bvh.nodes[0].maxAABB;
+
+		struct Task
+		{
+			uint32_t binaryIndex;
+			uint32_t wideIndex;
+		};
+
+		std::vector<Task> tasks{ Task{ 0, 0 } };
+		nodes.reserve(bvh.nodes.size() / 4 + 1);
+		nodes.emplace_back();
+
+		while (!tasks.empty())
+		{
+			const Task task{ tasks.back() };
+			tasks.pop_back();
+
+			// Keep opening the interior child with the largest surface area until all lanes are used
+			uint32_t candidates[WideBVHNode::Width]{};
+			uint32_t candidateCount{};
+
+			const BVHNode& binaryNode{ bvh.nodes[task.binaryIndex] };
+			if (binaryNode.IsLeaf())
+			{
+				candidates[candidateCount++] = task.binaryIndex;
+			}
+			else
+			{
+				candidates[candidateCount++] = binaryNode.leftFirst;
+				candidates[candidateCount++] = binaryNode.leftFirst + 1;
+			}
+
+			while (candidateCount < WideBVHNode::Width)
+			{
+				int largest{ -1 };
+				float largestArea{ -1.0f };
+
+				for (uint32_t candidate{}; candidate < candidateCount; ++candidate)
+				{
+					const BVHNode& node{ bvh.nodes[candidates[candidate]] };
+					if (node.IsLeaf()) continue;
+
+					const float area{ SurfaceArea(node.minAABB, node.maxAABB) };
+					if (area > largestArea)
+					{
+						largest = candidate;
+						largestArea = area;
+					}
+				}
+
+				if (largest == -1) break;
+
+				const uint32_t leftIndex{ bvh.nodes[candidates[largest]].leftFirst };
+				candidates[largest] = leftIndex;
+				candidates[candidateCount++] = leftIndex + 1;
+			}
+
+			// Filled in locally, adding child nodes below can reallocate
+			WideBVHNode wideNode{};
+			wideNode.childCount = candidateCount;
+
+			for (uint32_t lane{}; lane < WideBVHNode::Width; ++lane)
+			{
+				if (lane >= candidateCount)
+				{
+					wideNode.minX[lane] = wideNode.minY[lane] = wideNode.minZ[lane] = FLT_MAX;
+					wideNode.maxX[lane] = wideNode.maxY[lane] = wideNode.maxZ[lane] = -FLT_MAX;
+					continue;
+				}
+
+				const BVHNode& child{ bvh.nodes[candidates[lane]] };
+
+				wideNode.minX[lane] = child.minAABB.x;
+				wideNode.minY[lane] = child.minAABB.y;
+				wideNode.minZ[lane] = child.minAABB.z;
+				wideNode.maxX[lane] = child.maxAABB.x;
+				wideNode.maxY[lane] = child.maxAABB.y;
+				wideNode.maxZ[lane] = child.maxAABB.z;
+
+				if (child.IsLeaf())
+				{
+					wideNode.children[lane] = candidates[lane] | WideBVHNode::LeafFlag;
+				}
+				else
+				{
+					wideNode.children[lane] = static_cast<uint32_t>(nodes.size());
+					tasks.emplace_back(Task{ candidates[lane], wideNode.children[lane] });
+					nodes.emplace_back();
+				}
+			}
+
+			nodes[task.wideIndex] = wideNode;
+		}
+	}
+
+	void WideBVH::Clear()
+	{
+		nodes.clear();
+	}
+}
\ No newline at end of file
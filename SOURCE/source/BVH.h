@@ -0,0 +1,93 @@
+#pragma once
+
+// External includes
+#include <vector>
+#include <cstdint>
+
+// Project includes
+#include "Math.h"
+
+namespace dae
+{
+	struct BVHNode
+	{
+		bool IsLeaf() const { return primitiveCount > 0; }
+
+		Vector3 minAABB;
+		Vector3 maxAABB;
+		uint32_t leftFirst;			// Index of the left child (right child is leftFirst + 1) or of the first primitive for a leaf
+		uint32_t primitiveCount;	// 0 for interior nodes
+	};
+
+	/**
+	 * \brief Bounding volume hierarchy built with the binned surface area heuristic
+	 * Used per mesh over its triangles, and per scene over its bounded primitives
+	 */
+	struct BVH
+	{
+		BVH();
+
+		void Build(const std::vector<Vector3>& positions, const std::vector<int>& indices);
+		void Build(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+		void Refit(const std::vector<Vector3>& positions, const std::vector<int>& indices);
+		void Refit(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+		bool NeedsRebuild() const;
+		float CalculateCost() const;
+		void Clear();
+
+		std::vector<BVHNode> nodes;
+		std::vector<uint32_t> primitiveIndices;
+		float buildCost;			// SAH cost right after the last full build
+		float cost;					// SAH cost of the tree as it is now, grows as refits loosen the nodes
+		float lastBuildTime;		// Milliseconds spent in the last full build
+		float lastRefitTime;		// Milliseconds spent in the last refit
+		uint32_t refitCount;		// Refits since the last full build
+		uint32_t leafBatchSize;		// Primitives a leaf tests at once, the SAH rounds leaf sizes up to a multiple of it
+
+	private:
+		void Subdivide(uint32_t rootIndex, const std::vector<Vector3>& centroids, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+		void UpdateNodeBounds(uint32_t nodeIndex, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+		void RefitInteriorNode(BVHNode& node);
+		float BatchCount(uint32_t primitiveCount) const;
+	};
+
+	/**
+	 * \brief Node of a BVH with up to 8 children, their boxes stored per component so all of them can be slab tested at once
+	 */
+	struct alignas(32) WideBVHNode
+	{
+		static constexpr uint32_t Width{ 8 };
+		static constexpr uint32_t LeafFlag{ 0x80000000u };
+
+		float minX[Width];
+		float minY[Width];
+		float minZ[Width];
+		float maxX[Width];
+		float maxY[Width];
+		float maxZ[Width];
+		uint32_t children[Width];	// Index of a wide node, or of a leaf of the binary BVH when LeafFlag is set
+		uint32_t childCount;		// Children fill the lanes from 0 onwards
+	};
+
+	/**
+	 * \brief 8-wide BVH collapsed from a binary one, cutting the number of traversal steps and node fetches per ray by about 3x
+	 * Its leaves are the leaves of the binary BVH, so anything indexed by binary leaf stays valid
+	 */
+	struct WideBVH
+	{
+		WideBVH();
+
+		void Build(const BVH& bvh);
+		void Clear();
+
+		std::vector<WideBVHNode> nodes;
+		Vector3 minAABB;			// Bounds of the root, so rays that miss the whole tree are rejected with a single box test
+		Vector3 maxAABB;
+	};
+
+	inline float SurfaceArea(const Vector3& minAABB, const Vector3& maxAABB)
+	{
+		const Vector3 extent{ maxAABB - minAABB };
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+}
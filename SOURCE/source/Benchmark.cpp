@@ -0,0 +1,1033 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Benchmark.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "RenderStats.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace
+	{
+		std::vector<Ray> GenerateCameraRays(Camera& camera, uint32_t width, uint32_t height)
+		{
+			const Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
+			const float fieldOfView{ tanf((TO_RADIANS * camera.fovAngle) / 2) };
+			const float aspectRatio{ float(width) / float(height) };
+
+			std::vector<Ray> rays{};
+			rays.reserve(size_t(width) * height);
+
+			for (uint32_t py{}; py < height; ++py)
+			{
+				for (uint32_t px{}; px < width; ++px)
+				{
+					const float worldX{ (2 * ((px + 0.5f) / float(width)) - 1) * aspectRatio * fieldOfView };
+					const float worldY{ (1 - (2 * ((py + 0.5f) / float(height)))) * fieldOfView };
+
+					rays.emplace_back(Ray{ camera.origin, cameraToWorld.TransformVector(Vector3{ worldX, worldY, 1.0f }.Normalized()) });
+				}
+			}
+
+			return rays;
+		}
+
+		// Mesh as the benchmark sees it, world space meshes use an identity transform
+		struct BenchmarkMesh
+		{
+			const TriangleMesh* pMesh;
+			const std::vector<Vector3>* pPositions;
+			const std::vector<Vector3>* pNormals;
+			Matrix worldToObject;
+			Vector3 minAABB;
+			Vector3 maxAABB;
+		};
+
+		std::vector<BenchmarkMesh> GatherMeshes(const Scene& scene)
+		{
+			std::vector<BenchmarkMesh> meshes{};
+
+			for (const TriangleMesh& mesh : scene.GetTriangleMeshes())
+			{
+				meshes.emplace_back(BenchmarkMesh{ &mesh, &mesh.transformedPositions, &mesh.transformedNormals, Matrix{}, mesh.transformedMinAABB, mesh.transformedMaxAABB });
+			}
+
+			for (const MeshInstance& instance : scene.GetMeshInstances())
+			{
+				const TriangleMesh& mesh{ *instance.pMesh };
+				meshes.emplace_back(BenchmarkMesh{ &mesh, &mesh.positions, &mesh.normals, instance.worldToObject, mesh.minAABB, mesh.maxAABB });
+			}
+
+			return meshes;
+		}
+
+		// The triangle test as it was before the Möller–Trumbore kernel, kept here as the baseline to measure against
+		bool HitTest_Triangle_Reference(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
+		{
+			const Vector3 a{ triangle.v1 - triangle.v0 };
+			const Vector3 b{ triangle.v2 - triangle.v0 };
+			const Vector3 n{ Vector3::Cross(a, b).Normalized() };
+
+			switch (triangle.cullMode)
+			{
+				case TriangleCullMode::NoCulling:
+					if (AreEqual(Vector3::Dot(n, ray.direction), 0.0f)) return false;
+					break;
+				case TriangleCullMode::FrontFaceCulling:
+					if (Vector3::Dot(n, ray.direction) < 0.0f) return false;
+					break;
+				case TriangleCullMode::BackFaceCulling:
+					if (Vector3::Dot(n, ray.direction) > 0.0f) return false;
+					break;
+			}
+
+			const Vector3 L{ triangle.v0 - ray.origin };
+			const float t{ Vector3::Dot(L, n) / Vector3::Dot(ray.direction, n) };
+
+			if (t < ray.min || t > ray.max) return false;
+
+			const Vector3 P{ ray.origin + (ray.direction * t) };
+
+			const Vector3 e0{ triangle.v1 - triangle.v0 };
+			const Vector3 e1{ triangle.v2 - triangle.v1 };
+			const Vector3 e2{ triangle.v0 - triangle.v2 };
+
+			const Vector3 p0{ P - triangle.v0 };
+			const Vector3 p1{ P - triangle.v1 };
+			const Vector3 p2{ P - triangle.v2 };
+
+			if (Vector3::Dot(Vector3::Cross(e0, p0), n) < 0.0f) return false;
+			if (Vector3::Dot(Vector3::Cross(e1, p1), n) < 0.0f) return false;
+			if (Vector3::Dot(Vector3::Cross(e2, p2), n) < 0.0f) return false;
+
+			hitRecord.origin = P;
+			hitRecord.normal = triangle.normal;
+			hitRecord.t = t;
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = triangle.materialIndex;
+
+			return true;
+		}
+
+		// The mesh test as it was before the BVH and the Möller–Trumbore kernel, kept here as the baseline to measure against
+		bool HitTest_TriangleMesh_Linear(const BenchmarkMesh& mesh, const Ray& worldRay, HitRecord& hitRecord)
+		{
+			const Ray ray{ GeometryUtils::TransformRay(worldRay, mesh.worldToObject) };
+			const Vector3 inverseDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+			if (GeometryUtils::SlabTest_AABB(mesh.minAABB, mesh.maxAABB, ray, inverseDirection) == FLT_MAX) return false;
+
+			HitRecord closestHit{};
+
+			for (size_t index{}; index < mesh.pMesh->indices.size(); index += 3)
+			{
+				HitTest_Triangle_Reference(GeometryUtils::GetMeshTriangle(*mesh.pMesh, *mesh.pPositions, *mesh.pNormals, uint32_t(index / 3)), ray, hitRecord);
+				if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+			}
+
+			hitRecord = closestHit;
+
+			return hitRecord.didHit;
+		}
+
+		bool HitTest_TriangleMesh_Linear(const BenchmarkMesh& mesh, const Ray& ray)
+		{
+			HitRecord temp{};
+			return HitTest_TriangleMesh_Linear(mesh, ray, temp);
+		}
+
+		// Scene::IsOccluded as it was before the top level BVH, it went over every primitive and ran full closest hit tests on the meshes
+		bool IsOccluded_Reference(const Scene& scene, const std::vector<BenchmarkMesh>& meshes, const Ray& ray)
+		{
+			for (const Sphere& sphere : scene.GetSpheres())
+			{
+				if (GeometryUtils::HitTest_Sphere(sphere, ray)) return true;
+			}
+
+			for (const Plane& plane : scene.GetPlanes())
+			{
+				if (GeometryUtils::HitTest_Plane(plane, ray)) return true;
+			}
+
+			for (const Triangle& triangle : scene.GetTriangles())
+			{
+				if (GeometryUtils::HitTest_Triangle(triangle, ray)) return true;
+			}
+
+			for (const BenchmarkMesh& mesh : meshes)
+			{
+				if (HitTest_TriangleMesh_Linear(mesh, ray)) return true;
+			}
+
+			return false;
+		}
+
+		// The mesh test through the binary BVH, before it got collapsed into a wide one
+		bool HitTest_TriangleMesh_BinaryBVH(const BenchmarkMesh& mesh, const Ray& worldRay, HitRecord& hitRecord)
+		{
+			const Ray ray{ GeometryUtils::TransformRay(worldRay, mesh.worldToObject) };
+			const GeometryUtils::BlockRay blockRay{ GeometryUtils::BroadcastRay(ray) };
+			const TriangleMesh& triangleMesh{ *mesh.pMesh };
+
+			Ray closestRay{ ray };
+			uint32_t closestIndex{ UINT32_MAX };
+
+			GeometryUtils::TraverseBVHLeaves_ClosestHit(triangleMesh.bvh, closestRay,
+				[&](uint32_t nodeIndex, Ray& currentRay)
+				{
+					const uint32_t firstBlock{ triangleMesh.leafBlockOffsets[nodeIndex] };
+					const uint32_t blockCount{ (triangleMesh.bvh.nodes[nodeIndex].primitiveCount + TriangleBlock::Width - 1) / TriangleBlock::Width };
+
+					for (uint32_t blockIndex{ firstBlock }; blockIndex < firstBlock + blockCount; ++blockIndex)
+					{
+						uint32_t triangleIndex{};
+						const float t{ GeometryUtils::IntersectTriangleBlock(triangleMesh.triangleBlocks[blockIndex], triangleMesh.cullMode, blockRay, currentRay, triangleIndex) };
+						if (t == FLT_MAX) continue;
+
+						currentRay.max = t;
+						closestIndex = triangleIndex;
+					}
+				}
+			);
+
+			if (closestIndex == UINT32_MAX) return false;
+
+			hitRecord.t = closestRay.max;
+			hitRecord.didHit = true;
+
+			return true;
+		}
+
+		bool HitTest_TriangleMesh_BinaryBVH(const BenchmarkMesh& mesh, const Ray& worldRay)
+		{
+			const Ray ray{ GeometryUtils::TransformRay(worldRay, mesh.worldToObject) };
+			const GeometryUtils::BlockRay blockRay{ GeometryUtils::BroadcastRay(ray) };
+			const TriangleMesh& triangleMesh{ *mesh.pMesh };
+
+			return GeometryUtils::TraverseBVHLeaves_AnyHit(triangleMesh.bvh, ray,
+				[&](uint32_t nodeIndex)
+				{
+					const uint32_t firstBlock{ triangleMesh.leafBlockOffsets[nodeIndex] };
+					const uint32_t blockCount{ (triangleMesh.bvh.nodes[nodeIndex].primitiveCount + TriangleBlock::Width - 1) / TriangleBlock::Width };
+
+					for (uint32_t blockIndex{ firstBlock }; blockIndex < firstBlock + blockCount; ++blockIndex)
+					{
+						if (GeometryUtils::HitTest_TriangleBlock(triangleMesh.triangleBlocks[blockIndex], triangleMesh.cullMode, blockRay, ray)) return true;
+					}
+
+					return false;
+				}
+			);
+		}
+
+		bool HitTest_TriangleMesh_BVH(const BenchmarkMesh& mesh, const Ray& ray, HitRecord& hitRecord)
+		{
+			return GeometryUtils::HitTest_TriangleMesh(*mesh.pMesh, *mesh.pNormals, GeometryUtils::TransformRay(ray, mesh.worldToObject), hitRecord);
+		}
+
+		bool HitTest_TriangleMesh_BVH(const BenchmarkMesh& mesh, const Ray& ray)
+		{
+			return GeometryUtils::HitTest_TriangleMesh(*mesh.pMesh, GeometryUtils::TransformRay(ray, mesh.worldToObject));
+		}
+
+		// Nearest rank percentile of sorted samples
+		double Percentile(const std::vector<double>& sortedSamples, double percentile)
+		{
+			const size_t rank{ size_t(std::ceil(percentile / 100.0 * sortedSamples.size())) };
+			return sortedSamples[std::clamp(rank, size_t(1), sortedSamples.size()) - 1];
+		}
+
+#if defined(_MSC_VER)
+	#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+	#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+		// Same bodies as the old Vector3.cpp and Matrix.cpp, kept out of line to measure what a call per operation used to cost
+		BENCHMARK_NOINLINE Vector3 Cross_OutOfLine(const Vector3& v1, const Vector3& v2)
+		{
+			return Vector3{ (v1.y * v2.z) - (v1.z * v2.y), (v1.z * v2.x) - (v1.x * v2.z), (v1.x * v2.y) - (v1.y * v2.x) };
+		}
+
+		BENCHMARK_NOINLINE Vector3 TransformPoint_OutOfLine(const Matrix& matrix, const Vector3& p)
+		{
+			const Vector4 row0{ matrix[0] }, row1{ matrix[1] }, row2{ matrix[2] }, row3{ matrix[3] };
+
+			return Vector3{
+				row0.x * p.x + row1.x * p.y + row2.x * p.z + row3.x,
+				row0.y * p.x + row1.y * p.y + row2.y * p.z + row3.y,
+				row0.z * p.x + row1.z * p.y + row2.z * p.z + row3.z,
+			};
+		}
+
+		template<typename Function>
+		double MeasureSeconds(Function function)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			function();
+			const auto end{ std::chrono::high_resolution_clock::now() };
+
+			return std::chrono::duration<double>(end - start).count();
+		}
+
+		void PrintResult(const char* name, size_t rayCount, double linearSeconds, double binarySeconds, double wideSeconds)
+		{
+			const double linearMrays{ rayCount / linearSeconds / 1'000'000.0 };
+			const double binaryMrays{ rayCount / binarySeconds / 1'000'000.0 };
+			const double wideMrays{ rayCount / wideSeconds / 1'000'000.0 };
+
+			std::cout << ">> " << name << ": " << rayCount << " rays, linear = " << linearMrays << " Mrays/s, BVH2 = " << binaryMrays
+				<< " Mrays/s (x" << (binaryMrays / linearMrays) << "), BVH8 = " << wideMrays << " Mrays/s (x" << (wideMrays / linearMrays) << ")" << std::endl;
+		}
+
+		// unit names what count counts, tests when every kernel runs all of them and rays when the kernels stop at different triangles
+		void PrintKernelResult(const char* name, size_t count, const char* unit, double referenceSeconds, const char* kernelName, double kernelSeconds)
+		{
+			const double referenceRate{ count / referenceSeconds / 1'000'000.0 };
+			const double kernelRate{ count / kernelSeconds / 1'000'000.0 };
+
+			std::cout << ">> " << name << ": " << count << " " << unit << ", reference = " << referenceRate << " M" << unit << "/s, " << kernelName << " = " << kernelRate
+				<< " M" << unit << "/s (x" << (kernelRate / referenceRate) << ")" << std::endl;
+		}
+	}
+
+	void Benchmark::MeshTraversal(Scene& scene, uint32_t width, uint32_t height)
+	{
+		const std::vector<BenchmarkMesh> meshes{ GatherMeshes(scene) };
+		if (meshes.empty())
+		{
+			std::cout << "(Mesh benchmark skipped, the scene has no triangle meshes or mesh instances)" << std::endl;
+			return;
+		}
+
+		const std::vector<Ray> cameraRays{ GenerateCameraRays(scene.GetCamera(), width, height) };
+		std::vector<HitRecord> linearHits(cameraRays.size());
+		std::vector<HitRecord> binaryHits(cameraRays.size());
+		std::vector<HitRecord> bvhHits(cameraRays.size());
+
+		std::cout << "**MESH BENCHMARK STARTED**" << std::endl;
+
+		const double linearPrimarySeconds{ MeasureSeconds([&]()
+			{
+				for (size_t index{}; index < cameraRays.size(); ++index)
+				{
+					HitRecord hitRecord{};
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_Linear(mesh, cameraRays[index], hitRecord) && hitRecord.t < linearHits[index].t) linearHits[index] = hitRecord;
+					}
+				}
+			}
+		) };
+
+		const double binaryPrimarySeconds{ MeasureSeconds([&]()
+			{
+				for (size_t index{}; index < cameraRays.size(); ++index)
+				{
+					HitRecord hitRecord{};
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_BinaryBVH(mesh, cameraRays[index], hitRecord) && hitRecord.t < binaryHits[index].t) binaryHits[index] = hitRecord;
+					}
+				}
+			}
+		) };
+
+		const double bvhPrimarySeconds{ MeasureSeconds([&]()
+			{
+				for (size_t index{}; index < cameraRays.size(); ++index)
+				{
+					HitRecord hitRecord{};
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_BVH(mesh, cameraRays[index], hitRecord) && hitRecord.t < bvhHits[index].t) bvhHits[index] = hitRecord;
+					}
+				}
+			}
+		) };
+
+		// Shadow rays from every mesh hit towards every light, like the renderer casts them
+		std::vector<Ray> shadowRays{};
+		size_t mismatches{};
+
+		for (size_t index{}; index < cameraRays.size(); ++index)
+		{
+			if (linearHits[index].didHit != bvhHits[index].didHit || !AreEqual(linearHits[index].t, bvhHits[index].t, 0.001f)) ++mismatches;
+			if (binaryHits[index].didHit != bvhHits[index].didHit || !AreEqual(binaryHits[index].t, bvhHits[index].t, 0.001f)) ++mismatches;
+			if (!bvhHits[index].didHit) continue;
+
+			const Vector3 hitOrigin{ cameraRays[index].origin + cameraRays[index].direction * bvhHits[index].t };
+
+			for (const Light& light : scene.GetLights())
+			{
+				const Vector3 direction{ LightUtils::GetDirectionToLight(light, hitOrigin) };
+				const float magnitude{ direction.Magnitude() };
+				if (magnitude <= 0.0f) continue;
+
+				Ray shadowRay{ hitOrigin, direction / magnitude };
+				shadowRay.min = 0.01f;
+				shadowRay.max = magnitude;
+				shadowRays.emplace_back(shadowRay);
+			}
+		}
+
+		size_t linearOccluded{};
+		size_t binaryOccluded{};
+		size_t bvhOccluded{};
+
+		const double linearShadowSeconds{ MeasureSeconds([&]()
+			{
+				for (const Ray& ray : shadowRays)
+				{
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_Linear(mesh, ray))
+						{
+							++linearOccluded;
+							break;
+						}
+					}
+				}
+			}
+		) };
+
+		const double binaryShadowSeconds{ MeasureSeconds([&]()
+			{
+				for (const Ray& ray : shadowRays)
+				{
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_BinaryBVH(mesh, ray))
+						{
+							++binaryOccluded;
+							break;
+						}
+					}
+				}
+			}
+		) };
+
+		const double bvhShadowSeconds{ MeasureSeconds([&]()
+			{
+				for (const Ray& ray : shadowRays)
+				{
+					for (const BenchmarkMesh& mesh : meshes)
+					{
+						if (HitTest_TriangleMesh_BVH(mesh, ray))
+						{
+							++bvhOccluded;
+							break;
+						}
+					}
+				}
+			}
+		) };
+
+		size_t triangleCount{};
+		size_t binaryNodeCount{};
+		size_t wideNodeCount{};
+		for (const BenchmarkMesh& mesh : meshes)
+		{
+			triangleCount += mesh.pMesh->indices.size() / 3;
+			binaryNodeCount += mesh.pMesh->bvh.nodes.size();
+			wideNodeCount += mesh.pMesh->wideBVH.nodes.size();
+		}
+
+		std::cout << "**MESH BENCHMARK FINISHED** (" << meshes.size() << " meshes, " << triangleCount << " triangles, " << binaryNodeCount << " BVH2 nodes, "
+			<< wideNodeCount << " BVH8 nodes)" << std::endl;
+		PrintResult("Primary", cameraRays.size(), linearPrimarySeconds, binaryPrimarySeconds, bvhPrimarySeconds);
+		PrintResult("Shadow", shadowRays.size(), linearShadowSeconds, binaryShadowSeconds, bvhShadowSeconds);
+
+		if (mismatches > 0 || linearOccluded != bvhOccluded || binaryOccluded != bvhOccluded)
+		{
+			std::cout << ">> WARNING: " << mismatches << " primary hits and " << (std::max(linearOccluded, bvhOccluded) - std::min(linearOccluded, bvhOccluded))
+				+ (std::max(binaryOccluded, bvhOccluded) - std::min(binaryOccluded, bvhOccluded)) << " shadow rays differ between the linear loop and the BVHs" << std::endl;
+		}
+	}
+
+	void Benchmark::TriangleKernel(Scene& scene, uint32_t width, uint32_t height)
+	{
+		const std::vector<BenchmarkMesh> meshes{ GatherMeshes(scene) };
+		if (meshes.empty())
+		{
+			std::cout << "(Triangle benchmark skipped, the scene has no triangle meshes or mesh instances)" << std::endl;
+			return;
+		}
+
+		// Every ray gets tested against every triangle, so both kernels do exactly the same amount of work
+		const std::vector<Ray> cameraRays{ GenerateCameraRays(scene.GetCamera(), width, height) };
+		std::vector<float> referenceHits(cameraRays.size() * meshes.size(), FLT_MAX);
+		std::vector<float> kernelHits(cameraRays.size() * meshes.size(), FLT_MAX);
+		std::vector<float> blockHits(cameraRays.size() * meshes.size(), FLT_MAX);
+		size_t referenceOccluded{};
+		size_t kernelOccluded{};
+		size_t blockOccluded{};
+		size_t testCount{};
+		const size_t rayCount{ cameraRays.size() * meshes.size() };
+
+		for (const BenchmarkMesh& mesh : meshes)
+		{
+			testCount += cameraRays.size() * (mesh.pMesh->indices.size() / 3);
+		}
+
+		std::cout << "**TRIANGLE BENCHMARK STARTED**" << std::endl;
+
+		const double referenceClosestSeconds{ MeasureSeconds([&]()
+			{
+				for (size_t meshIndex{}; meshIndex < meshes.size(); ++meshIndex)
+				{
+					const BenchmarkMesh& mesh{ meshes[meshIndex] };
+					const uint32_t triangleCount{ uint32_t(mesh.pMesh->indices.size() / 3) };
+
+					for (size_t rayIndex{}; rayIndex < cameraRays.size(); ++rayIndex)
+					{
+						Ray ray{ GeometryUtils::TransformRay(cameraRays[rayIndex], mesh.worldToObject) };
+						HitRecord hitRecord{};
+
+						// The old test does not compare with the hit it already has, so the ray is shortened to keep the closest one
+						for (uint32_t triangleIndex{}; triangleIndex < triangleCount; ++triangleIndex)
+						{
+							if (HitTest_Triangle_Reference(GeometryUtils::GetMeshTriangle(*mesh.pMesh, *mesh.pPositions, *mesh.pNormals, triangleIndex), ray, hitRecord))
+							{
+								ray.max = hitRecord.t;
+							}
+						}
+
+						referenceHits[meshIndex * cameraRays.size() + rayIndex] = hitRecord.t;
+					}
+				}
+			}
+		) };
+
+		const double kernelClosestSeconds{ MeasureSeconds([&]()
+			{
+				for (size_t meshIndex{}; meshIndex < meshes.size(); ++meshIndex)
+				{
+					const BenchmarkMesh& mesh{ meshes[meshIndex] };
+
+					for (size_t rayIndex{}; rayIndex < cameraRays.size(); ++rayIndex)
+					{
+						const Ray ray{ GeometryUtils::TransformRay(cameraRays[rayIndex], mesh.worldToObject) };
+						float closestT{ FLT_MAX };
+
+						for (const PrecomputedTriangle& triangle : mesh.pMesh->precomputedTriangles)
+						{
+							closestT = std::min(closestT, GeometryUtils::IntersectTriangle(triangle, mesh.pMesh->cullMode, ray));
+						}
+
+						kernelHits[meshIndex * cameraRays.size() + rayIndex] = closestT;
+					}
+				}
+			}
+		) };
+
+		const double referenceOcclusionSeconds{ MeasureSeconds([&]()
+			{
+				for (const BenchmarkMesh& mesh : meshes)
+				{
+					const uint32_t triangleCount{ uint32_t(mesh.pMesh->indices.size() / 3) };
+
+					for (const Ray& cameraRay : cameraRays)
+					{
+						const Ray ray{ GeometryUtils::TransformRay(cameraRay, mesh.worldToObject) };
+						HitRecord hitRecord{};
+
+						for (uint32_t triangleIndex{}; triangleIndex < triangleCount; ++triangleIndex)
+						{
+							if (HitTest_Triangle_Reference(GeometryUtils::GetMeshTriangle(*mesh.pMesh, *mesh.pPositions, *mesh.pNormals, triangleIndex), ray, hitRecord))
+							{
+								++referenceOccluded;
+								break;
+							}
+						}
+					}
+				}
+			}
+		) };
+
+		const double kernelOcclusionSeconds{ MeasureSeconds([&]()
+			{
+				for (const BenchmarkMesh& mesh : meshes)
+				{
+					for (const Ray& cameraRay : cameraRays)
+					{
+						const Ray ray{ GeometryUtils::TransformRay(cameraRay, mesh.worldToObject) };
+
+						for (const PrecomputedTriangle& triangle : mesh.pMesh->precomputedTriangles)
+						{
+							if (GeometryUtils::IntersectTriangle(triangle, mesh.pMesh->cullMode, ray) != FLT_MAX)
+							{
+								++kernelOccluded;
+								break;
+							}
+						}
+					}
+				}
+			}
+		) };
+
+		// The blocks hold the triangles leaf after leaf, so walking all of them covers every triangle of the mesh once
+		const double blockClosestSeconds{ MeasureSeconds([&]()
+			{
+				for (size_t meshIndex{}; meshIndex < meshes.size(); ++meshIndex)
+				{
+					const BenchmarkMesh& mesh{ meshes[meshIndex] };
+
+					for (size_t rayIndex{}; rayIndex < cameraRays.size(); ++rayIndex)
+					{
+						Ray ray{ GeometryUtils::TransformRay(cameraRays[rayIndex], mesh.worldToObject) };
+						const GeometryUtils::BlockRay blockRay{ GeometryUtils::BroadcastRay(ray) };
+
+						for (const TriangleBlock& block : mesh.pMesh->triangleBlocks)
+						{
+							uint32_t triangleIndex{};
+							const float t{ GeometryUtils::IntersectTriangleBlock(block, mesh.pMesh->cullMode, blockRay, ray, triangleIndex) };
+							if (t != FLT_MAX) ray.max = t;
+						}
+
+						blockHits[meshIndex * cameraRays.size() + rayIndex] = (ray.max == cameraRays[rayIndex].max) ? FLT_MAX : ray.max;
+					}
+				}
+			}
+		) };
+
+		const double blockOcclusionSeconds{ MeasureSeconds([&]()
+			{
+				for (const BenchmarkMesh& mesh : meshes)
+				{
+					for (const Ray& cameraRay : cameraRays)
+					{
+						const Ray ray{ GeometryUtils::TransformRay(cameraRay, mesh.worldToObject) };
+						const GeometryUtils::BlockRay blockRay{ GeometryUtils::BroadcastRay(ray) };
+
+						for (const TriangleBlock& block : mesh.pMesh->triangleBlocks)
+						{
+							if (GeometryUtils::HitTest_TriangleBlock(block, mesh.pMesh->cullMode, blockRay, ray))
+							{
+								++blockOccluded;
+								break;
+							}
+						}
+					}
+				}
+			}
+		) };
+
+		size_t kernelMismatches{};
+		size_t blockMismatches{};
+		for (size_t index{}; index < referenceHits.size(); ++index)
+		{
+			if ((referenceHits[index] == FLT_MAX) != (kernelHits[index] == FLT_MAX)) ++kernelMismatches;
+			else if (referenceHits[index] != FLT_MAX && !AreEqual(referenceHits[index], kernelHits[index], 0.001f)) ++kernelMismatches;
+
+			if ((kernelHits[index] == FLT_MAX) != (blockHits[index] == FLT_MAX)) ++blockMismatches;
+			else if (kernelHits[index] != FLT_MAX && !AreEqual(kernelHits[index], blockHits[index], 0.001f)) ++blockMismatches;
+		}
+
+		std::cout << "**TRIANGLE BENCHMARK FINISHED** (" << cameraRays.size() << " rays, " << meshes.size() << " meshes)" << std::endl;
+		PrintKernelResult("Closest hit", testCount, "tests", referenceClosestSeconds, "Moller-Trumbore", kernelClosestSeconds);
+		PrintKernelResult("Closest hit", testCount, "tests", referenceClosestSeconds, "8-wide blocks", blockClosestSeconds);
+		PrintKernelResult("Occlusion (early out)", rayCount, "rays", referenceOcclusionSeconds, "Moller-Trumbore", kernelOcclusionSeconds);
+		PrintKernelResult("Occlusion (early out)", rayCount, "rays", referenceOcclusionSeconds, "8-wide blocks", blockOcclusionSeconds);
+
+		// Rays grazing an edge can go either way, as neither test is watertight and they round differently
+		std::cout << ">> " << kernelMismatches << " closest hits and " << (std::max(referenceOccluded, kernelOccluded) - std::min(referenceOccluded, kernelOccluded))
+			<< " occlusion results differ from the reference test" << std::endl;
+		std::cout << ">> " << blockMismatches << " closest hits and " << (std::max(kernelOccluded, blockOccluded) - std::min(kernelOccluded, blockOccluded))
+			<< " occlusion results differ between the scalar and the 8-wide kernel" << std::endl;
+	}
+
+	void Benchmark::ShadowRays(Scene& scene, uint32_t width, uint32_t height)
+	{
+		const std::vector<BenchmarkMesh> meshes{ GatherMeshes(scene) };
+		const std::vector<Ray> cameraRays{ GenerateCameraRays(scene.GetCamera(), width, height) };
+
+		// The same shadow rays the renderer casts, one per light for every camera ray that hits something
+		std::vector<Ray> shadowRays{};
+		shadowRays.reserve(cameraRays.size() * scene.GetLights().size());
+
+		for (const Ray& cameraRay : cameraRays)
+		{
+			HitRecord closestHit{};
+			scene.GetClosestHit(cameraRay, closestHit);
+			if (!closestHit.didHit) continue;
+
+			for (const Light& light : scene.GetLights())
+			{
+				const Vector3 direction{ LightUtils::GetDirectionToLight(light, closestHit.origin) };
+				const float magnitude{ direction.Magnitude() };
+				if (magnitude <= 0.0f) continue;
+
+				Ray shadowRay{ closestHit.origin, direction / magnitude };
+				shadowRay.min = 0.01f;
+				shadowRay.max = magnitude;
+				shadowRays.emplace_back(shadowRay);
+			}
+		}
+
+		std::cout << "**SHADOW RAY BENCHMARK STARTED**" << std::endl;
+
+		size_t referenceOccluded{};
+		size_t occluded{};
+
+		const double referenceSeconds{ MeasureSeconds([&]()
+			{
+				for (const Ray& ray : shadowRays)
+				{
+					if (IsOccluded_Reference(scene, meshes, ray)) ++referenceOccluded;
+				}
+			}
+		) };
+
+		const double seconds{ MeasureSeconds([&]()
+			{
+				for (const Ray& ray : shadowRays)
+				{
+					if (scene.IsOccluded(ray)) ++occluded;
+				}
+			}
+		) };
+
+		const double referenceMrays{ shadowRays.size() / referenceSeconds / 1'000'000.0 };
+		const double mrays{ shadowRays.size() / seconds / 1'000'000.0 };
+
+		std::cout << "**SHADOW RAY BENCHMARK FINISHED** (" << scene.GetLights().size() << " lights, " << shadowRays.size() << " shadow rays, "
+			<< occluded << " occluded)" << std::endl;
+		std::cout << ">> Before: " << referenceMrays << " Mrays/s, " << (referenceSeconds * 1000.0) << " ms" << std::endl;
+		std::cout << ">> After: " << mrays << " Mrays/s, " << (seconds * 1000.0) << " ms (x" << (mrays / referenceMrays) << ")" << std::endl;
+
+		if (referenceOccluded != occluded)
+		{
+			std::cout << ">> WARNING: " << (std::max(referenceOccluded, occluded) - std::min(referenceOccluded, occluded)) << " shadow rays differ between both queries" << std::endl;
+		}
+	}
+
+	void Benchmark::PrimaryRays(Scene& scene, uint32_t width, uint32_t height, uint32_t repeatCount)
+	{
+		const std::vector<Ray> cameraRays{ GenerateCameraRays(scene.GetCamera(), width, height) };
+
+		// The same rays grouped into 4 by 2 pixel packets the way the renderer issues them, lanes past the image edge repeat the last pixel
+		std::vector<RayPacket> packets{};
+		std::vector<uint32_t> packetPixels{};
+		packets.reserve(cameraRays.size() / RayPacket::Width + width);
+
+		for (uint32_t py{}; py < height; py += RayPacket::Rows)
+		{
+			for (uint32_t px{}; px < width; px += RayPacket::Columns)
+			{
+				RayPacket packet{};
+				packet.origin = scene.GetCamera().origin;
+
+				for (uint32_t lane{}; lane < RayPacket::Width; ++lane)
+				{
+					const uint32_t x{ px + lane % RayPacket::Columns };
+					const uint32_t y{ py + lane / RayPacket::Columns };
+					if (x < width && y < height) packet.activeMask |= 1u << lane;
+
+					const uint32_t pixel{ std::min(x, width - 1) + std::min(y, height - 1) * width };
+					packet.directionX[lane] = cameraRays[pixel].direction.x;
+					packet.directionY[lane] = cameraRays[pixel].direction.y;
+					packet.directionZ[lane] = cameraRays[pixel].direction.z;
+					packetPixels.emplace_back(pixel);
+				}
+
+				packets.emplace_back(packet);
+			}
+		}
+
+		std::cout << "**PRIMARY RAY BENCHMARK STARTED** (" << width << "x" << height << ", " << repeatCount << " repeats)" << std::endl;
+
+		std::vector<HitRecord> singleHits(cameraRays.size());
+		std::vector<HitRecord> packetHits(packets.size() * RayPacket::Width);
+
+		const double singleSeconds{ MeasureSeconds([&]()
+			{
+				for (uint32_t repeat{}; repeat < repeatCount; ++repeat)
+				{
+					for (size_t index{}; index < cameraRays.size(); ++index) scene.GetClosestHit(cameraRays[index], singleHits[index]);
+				}
+			}
+		) };
+
+		const double packetSeconds{ MeasureSeconds([&]()
+			{
+				for (uint32_t repeat{}; repeat < repeatCount; ++repeat)
+				{
+					for (size_t index{}; index < packets.size(); ++index) scene.GetClosestHit(packets[index], &packetHits[index * RayPacket::Width]);
+				}
+			}
+		) };
+
+		// A lane counts as different when it disagrees on hitting anything or lands somewhere else than the single ray
+		size_t hitCount{};
+		size_t mismatchCount{};
+		for (size_t lane{}; lane < packetHits.size(); ++lane)
+		{
+			if ((packets[lane / RayPacket::Width].activeMask & (1u << (lane % RayPacket::Width))) == 0) continue;
+
+			const HitRecord& single{ singleHits[packetPixels[lane]] };
+			const HitRecord& packet{ packetHits[lane] };
+			if (packet.didHit) ++hitCount;
+			if (single.didHit != packet.didHit || (single.didHit && std::abs(single.t - packet.t) > 1e-3f * single.t)) ++mismatchCount;
+		}
+
+		const double rayCount{ double(cameraRays.size()) * repeatCount };
+		const double singleMrays{ rayCount / singleSeconds / 1'000'000.0 };
+		const double packetMrays{ rayCount / packetSeconds / 1'000'000.0 };
+
+		std::cout << "**PRIMARY RAY BENCHMARK FINISHED** (" << cameraRays.size() << " camera rays, " << hitCount << " hits)" << std::endl;
+		std::cout << ">> Single rays: " << singleMrays << " Mrays/s, " << (singleSeconds * 1000.0 / repeatCount) << " ms" << std::endl;
+		std::cout << ">> Packets of " << RayPacket::Width << ": " << packetMrays << " Mrays/s, " << (packetSeconds * 1000.0 / repeatCount) << " ms (x"
+			<< (packetMrays / singleMrays) << ")" << std::endl;
+
+		if (mismatchCount > 0)
+		{
+			std::cout << ">> WARNING: " << mismatchCount << " camera rays differ between both queries" << std::endl;
+		}
+	}
+
+	void Benchmark::MathKernels(uint32_t count, uint32_t repeatCount)
+	{
+		std::mt19937 generator{ 1234 };
+		std::uniform_real_distribution<float> distribution{ -10.0f, 10.0f };
+
+		std::vector<Vector3> points(count);
+		for (Vector3& point : points) point = Vector3{ distribution(generator), distribution(generator), distribution(generator) };
+
+		const Matrix matrix{ Matrix::CreateRotation(0.3f, 1.1f, -0.7f) * Matrix::CreateTranslation(1.0f, 2.0f, 3.0f) };
+		const size_t operationCount{ size_t(count) * repeatCount };
+
+		// Results go to memory and are summed afterwards, so neither loop can be optimized away and no add chain hides the call cost
+		std::vector<Vector3> outOfLineResults(count), inlinedResults(count);
+		const auto run{ [&](const char* name, auto outOfLine, auto inlined)
+			{
+				const double outOfLineSeconds{ MeasureSeconds([&]()
+					{
+						for (uint32_t repeat{}; repeat < repeatCount; ++repeat)
+						{
+							for (uint32_t index{}; index < count; ++index) outOfLineResults[index] = outOfLine(index);
+						}
+					}
+				) };
+				const double inlinedSeconds{ MeasureSeconds([&]()
+					{
+						for (uint32_t repeat{}; repeat < repeatCount; ++repeat)
+						{
+							for (uint32_t index{}; index < count; ++index) inlinedResults[index] = inlined(index);
+						}
+					}
+				) };
+
+				float largestDifference{};
+				for (uint32_t index{}; index < count; ++index) largestDifference = std::max(largestDifference, (outOfLineResults[index] - inlinedResults[index]).Magnitude());
+
+				std::cout << ">> " << name << ": out of line = " << (outOfLineSeconds * 1e9 / operationCount) << " ns, inline = " << (inlinedSeconds * 1e9 / operationCount)
+					<< " ns (x" << (outOfLineSeconds / inlinedSeconds) << "), largest difference = " << largestDifference << std::endl;
+			}
+		};
+
+		std::cout << "**MATH BENCHMARK STARTED** (" << count << " operations, " << repeatCount << " times)" << std::endl;
+
+		run("Matrix::TransformPoint",
+			[&](uint32_t index) { return TransformPoint_OutOfLine(matrix, points[index]); },
+			[&](uint32_t index) { return matrix.TransformPoint(points[index]); });
+		run("Vector3::Cross",
+			[&](uint32_t index) { return Cross_OutOfLine(points[index], points[count - 1 - index]); },
+			[&](uint32_t index) { return Vector3::Cross(points[index], points[count - 1 - index]); });
+
+		std::cout << "**MATH BENCHMARK FINISHED**" << std::endl;
+	}
+
+	void Benchmark::TileScheduler(Renderer& renderer, Scene& scene, uint32_t frameCount)
+	{
+		const uint32_t originalTileSize{ renderer.GetTileSize() };
+		const uint32_t originalThreadCount{ renderer.GetThreadCount() };
+		const uint32_t hardwareThreads{ std::max(1u, std::thread::hardware_concurrency()) };
+
+		std::vector<uint32_t> threadCounts{};
+		for (uint32_t threadCount{ 1 }; threadCount < hardwareThreads; threadCount *= 2) threadCounts.emplace_back(threadCount);
+		threadCounts.emplace_back(hardwareThreads);
+
+		const uint32_t tileSizes[]{ 8, 16, 32, 64 };
+
+		std::cout << "**TILE BENCHMARK STARTED** (" << frameCount << " frames per run)" << std::endl;
+
+		renderer.SetScene(&scene);
+		renderer.Render();
+
+		for (uint32_t threadCount : threadCounts)
+		{
+			renderer.SetThreadCount(threadCount);
+			std::cout << ">> " << threadCount << " threads:";
+
+			for (uint32_t tileSize : tileSizes)
+			{
+				renderer.SetTileSize(tileSize);
+
+				const double seconds{ MeasureSeconds([&]()
+					{
+						for (uint32_t frame{}; frame < frameCount; ++frame) renderer.Render();
+					}
+				) };
+
+				std::cout << " " << tileSize << "x" << tileSize << " = " << (seconds * 1000.0 / frameCount) << " ms";
+			}
+
+			std::cout << std::endl;
+		}
+
+		renderer.SetTileSize(originalTileSize);
+		renderer.SetThreadCount(originalThreadCount);
+
+		std::cout << "**TILE BENCHMARK FINISHED**" << std::endl;
+	}
+
+	void Benchmark::LightingModes(Renderer& renderer, Scene& scene, uint32_t frameCount)
+	{
+		const Renderer::LightingMode originalLightingMode{ renderer.GetLightingMode() };
+		const bool originalShadowsEnabled{ renderer.AreShadowsEnabled() };
+		const bool originalSortedShadingEnabled{ renderer.IsSortedShadingEnabled() };
+		const bool originalWavefrontEnabled{ renderer.IsWavefrontEnabled() };
+
+		const std::pair<Renderer::LightingMode, const char*> lightingModes[]{ { Renderer::LightingMode::ObservedArea, "Observed area" },
+			{ Renderer::LightingMode::Radiance, "Radiance" }, { Renderer::LightingMode::BDRF, "BDRF" }, { Renderer::LightingMode::Combined, "Combined" } };
+
+		std::cout << "**LIGHTING MODE BENCHMARK STARTED** (" << frameCount << " frames per run)" << std::endl;
+
+		renderer.SetScene(&scene);
+		renderer.Render();
+
+		for (const auto& [lightingMode, name] : lightingModes)
+		{
+			renderer.SetLightingMode(lightingMode);
+			std::cout << ">> " << name << ":";
+
+			for (const bool shadowsEnabled : { true, false })
+			{
+				renderer.SetShadowsEnabled(shadowsEnabled);
+				std::cout << (shadowsEnabled ? " shadows = " : ", no shadows = ");
+
+				// Per pixel, material sorted and wavefront, in that order
+				for (const uint32_t shadingOrder : { 0u, 1u, 2u })
+				{
+					renderer.SetSortedShadingEnabled(shadingOrder == 1);
+					renderer.SetWavefrontEnabled(shadingOrder == 2);
+
+					const double seconds{ MeasureSeconds([&]()
+						{
+							for (uint32_t frame{}; frame < frameCount; ++frame) renderer.Render();
+						}
+					) };
+
+					const char* const prefixes[]{ "", " (material sorted ", ", wavefront " };
+					std::cout << prefixes[shadingOrder] << (seconds * 1000.0 / frameCount) << (shadingOrder == 1 ? " ms)" : " ms");
+				}
+			}
+
+			std::cout << std::endl;
+		}
+
+		renderer.SetLightingMode(originalLightingMode);
+		renderer.SetShadowsEnabled(originalShadowsEnabled);
+		renderer.SetSortedShadingEnabled(originalSortedShadingEnabled);
+		renderer.SetWavefrontEnabled(originalWavefrontEnabled);
+
+		std::cout << "**LIGHTING MODE BENCHMARK FINISHED**" << std::endl;
+	}
+
+	void Benchmark::SceneBatch(std::ostream& json, uint32_t frameCount, float timeStep, uint32_t threadCount)
+	{
+		struct Resolution
+		{
+			uint32_t width;
+			uint32_t height;
+		};
+
+		const Resolution resolutions[]{ { 320, 240 }, { 640, 480 }, { 1280, 720 } };
+		frameCount = std::max(1u, frameCount);
+		threadCount = (threadCount > 0) ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+		bool isFirstRun{ true };
+
+		std::cout << "**BATCH BENCHMARK STARTED** (" << frameCount << " frames per run, " << threadCount << " threads)" << std::endl;
+
+		json << "{\n  \"threads\": " << threadCount << ",\n  \"frames\": " << frameCount << ",\n  \"timestep\": " << timeStep << ",\n  \"runs\": [\n";
+
+		for (const std::string& sceneName : GetSceneNames())
+		{
+			for (const Resolution& resolution : resolutions)
+			{
+				// Fresh scene, renderer and timer per run, so every run starts from the same state
+				std::unique_ptr<Scene> pScene{ CreateScene(sceneName) };
+				Renderer renderer{ resolution.width, resolution.height };
+				Timer timer{};
+
+				renderer.GetThreadPool().Resize(threadCount, false);
+				renderer.SetDirtyTilesEnabled(false);	// Whole frames, so the timings stay comparable with runs from before dirty tiles existed
+				pScene->SetThreadPool(&renderer.GetThreadPool());
+				pScene->Initialize();
+				timer.SetFixedTimeStep(timeStep);
+				timer.Start();
+#if defined(RAYTRACER_STATS)
+				// Drops whatever the scene setup and the previous run counted
+				Stats::CollectFrame();
+#endif
+
+				std::vector<double> frameMilliseconds{};
+				frameMilliseconds.reserve(frameCount);
+				uint64_t rayCount{};
+
+				for (uint32_t frame{}; frame < frameCount; ++frame)
+				{
+					frameMilliseconds.emplace_back(1000.0 * MeasureSeconds([&]()
+						{
+							pScene->Update(&timer);
+							pScene->UpdateTopLevelBVH();
+							renderer.SetScene(pScene.get());
+							renderer.Render();
+						}
+					));
+
+					rayCount += renderer.GetRayCount();
+					timer.Update();
+				}
+
+				const double totalSeconds{ std::accumulate(frameMilliseconds.begin(), frameMilliseconds.end(), 0.0) / 1000.0 };
+				std::sort(frameMilliseconds.begin(), frameMilliseconds.end());
+				// A coarse clock can measure a tiny scene as 0 s, and inf is not valid JSON
+				const double raysPerSecond{ (totalSeconds > 0.0) ? rayCount / totalSeconds : 0.0 };
+
+				json << (isFirstRun ? "" : ",\n") << "    { \"scene\": \"" << sceneName << "\", \"width\": " << resolution.width << ", \"height\": " << resolution.height
+					<< ", \"mean_ms\": " << totalSeconds * 1000.0 / frameCount
+					<< ", \"p50_ms\": " << Percentile(frameMilliseconds, 50.0)
+					<< ", \"p95_ms\": " << Percentile(frameMilliseconds, 95.0)
+					<< ", \"p99_ms\": " << Percentile(frameMilliseconds, 99.0)
+					<< ", \"rays\": " << rayCount
+					<< ", \"rays_per_second\": " << raysPerSecond;
+#if defined(RAYTRACER_STATS)
+				const Stats::FrameStats stats{ Stats::CollectFrame() };
+				json << ", \"stats\": ";
+				Stats::WriteJSON(json, stats);
+#endif
+				json << " }";
+				isFirstRun = false;
+
+				std::cout << ">> " << sceneName << " " << resolution.width << "x" << resolution.height << ": p50 = " << Percentile(frameMilliseconds, 50.0) << " ms, "
+					<< raysPerSecond / 1'000'000.0 << " Mrays/s" << std::endl;
+#if defined(RAYTRACER_STATS)
+				Stats::Print(std::cout, stats, frameCount);
+#endif
+			}
+		}
+
+		json << "\n  ]\n}\n";
+
+		std::cout << "**BATCH BENCHMARK FINISHED**" << std::endl;
+	}
+}
\ No newline at end of file
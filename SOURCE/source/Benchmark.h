@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+namespace dae
+{
+	// Forward Declerations
+	class Scene;
+	class Renderer;
+
+	namespace Benchmark
+	{
+		/**
+		 * \brief Traces the camera rays and shadow rays of the scene against every triangle mesh, with a linear loop over all triangles, through the binary mesh BVH and through the 8-wide one
+		 * \param width Horizontal resolution of the traced image
+		 * \param height Vertical resolution of the traced image
+		 */
+		void MeshTraversal(Scene& scene, uint32_t width, uint32_t height);
+
+		/**
+		 * \brief Tests the camera rays of the scene against every mesh triangle without any acceleration structure, once with the old
+		 * normal and cross product test, once with the Möller–Trumbore kernel on the precomputed triangles and once 8 triangles at a time on the triangle blocks
+		 */
+		void TriangleKernel(Scene& scene, uint32_t width, uint32_t height);
+
+		/**
+		 * \brief Casts the shadow rays of one frame through Scene::IsOccluded, and through a linear loop over every primitive with full closest hit mesh tests like before
+		 */
+		void ShadowRays(Scene& scene, uint32_t width, uint32_t height);
+
+		/**
+		 * \brief Casts the camera rays of one frame through Scene::GetClosestHit one at a time and in packets of 4 by 2 pixels, and checks both agree
+		 * \param repeatCount Times the whole frame is traced per query, so small resolutions still time reliably
+		 */
+		void PrimaryRays(Scene& scene, uint32_t width, uint32_t height, uint32_t repeatCount = 5);
+
+		/**
+		 * \brief Times Matrix::TransformPoint and Vector3::Cross from the header only math layer against out of line copies of the old Vector3.cpp and Matrix.cpp bodies
+		 * \param count Points transformed and crossed per repeat, small enough to stay in cache by default
+		 */
+		void MathKernels(uint32_t count = 16384, uint32_t repeatCount = 1000);
+
+		/**
+		 * \brief Renders the scene with every combination of tile size and thread count and prints the frame times
+		 * The tile size and thread count of the renderer are restored afterwards
+		 */
+		void TileScheduler(Renderer& renderer, Scene& scene, uint32_t frameCount = 10);
+
+		/**
+		 * \brief Renders the scene in every lighting mode with and without shadows and prints the frame times of each RenderPixel instantiation,
+		 * once shading every pixel right after its camera ray, once with the material sorted two pass tiles and once in wavefront passes over the whole frame
+		 * The lighting mode, shadow setting and shading order of the renderer are restored afterwards
+		 */
+		void LightingModes(Renderer& renderer, Scene& scene, uint32_t frameCount = 10);
+
+		/**
+		 * \brief Renders every Scene_* class at a few fixed resolutions, with a fixed timestep and without camera input, so runs can be compared across commits
+		 * Writes the frame time percentiles, rays per second and thread count of every run to json
+		 * \param frameCount Frames rendered per scene and resolution, each frame includes the scene update and top level BVH rebuild
+		 * \param timeStep Simulated seconds per frame
+		 * \param threadCount Render threads, 0 uses every hardware thread
+		 */
+		void SceneBatch(std::ostream& json, uint32_t frameCount = 30, float timeStep = 1.0f / 30.0f, uint32_t threadCount = 0);
+	}
+}
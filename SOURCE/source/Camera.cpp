@@ -10,7 +10,9 @@ namespace dae
 		right{ Vector3::UnitX },
 		totalPitch{ 0.0f },
 		totalYaw{ 0.0f },
-		cameraToWorld{ Matrix{} }
+		cameraToWorld{ Matrix{} },
+		input{},
+		version{ 0 }
 	{
 
 	}
@@ -23,7 +25,9 @@ namespace dae
 		right{ Vector3::UnitX },
 		totalPitch{ 0.0f },
 		totalYaw{ 0.0f },
-		cameraToWorld{ Matrix{} }
+		cameraToWorld{ Matrix{} },
+		input{},
+		version{ 0 }
 	{
 
 	}
@@ -43,55 +47,61 @@ namespace dae
 		const float deltaTime = pTimer->GetElapsed();
 		const float movementInterval{ 5.0f };
 		const float rotationInterval{ dae::TO_RADIANS * 5.0f };
+		const Vector3 previousOrigin{ origin };
+		const float previousPitch{ totalPitch };
+		const float previousYaw{ totalYaw };
 
 		//Keyboard Input
-		const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-
-		if (pKeyboardState[SDL_SCANCODE_W])
+		if (input.moveForward)
 		{
 			origin += forward * movementInterval * deltaTime;
 		}
-		if (pKeyboardState[SDL_SCANCODE_S])
+		if (input.moveBackward)
 		{
 			origin -= forward * movementInterval * deltaTime;
 		}
-		if (pKeyboardState[SDL_SCANCODE_D])
+		if (input.moveRight)
 		{
 			origin += right * movementInterval * deltaTime;
 		}
-		if (pKeyboardState[SDL_SCANCODE_A])
+		if (input.moveLeft)
 		{
 			origin -= right * movementInterval * deltaTime;
 		}
 
 
 		//Mouse Input
-		int mouseX{}, mouseY{};
-		const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
+		const float mouseX{ float(input.mouseX) };
+		const float mouseY{ float(input.mouseY) };
 
-		const bool LeftMouseButtonDown{ bool(mouseState & SDL_BUTTON_LMASK) };
-		const bool RightMouseButtonDown{ bool(mouseState & SDL_BUTTON_RMASK) };
+		const bool LeftMouseButtonDown{ input.leftMouseButton };
+		const bool RightMouseButtonDown{ input.rightMouseButton };
 
 		if (LeftMouseButtonDown)
 		{
 			if (RightMouseButtonDown)
 			{
-				origin -= up * float(mouseY) * deltaTime;
+				origin -= up * mouseY * deltaTime;
 			}
 			else
 			{
-				origin -= forward * float(mouseY) * deltaTime;
-				totalYaw += float(mouseX) * rotationInterval * deltaTime;
+				origin -= forward * mouseY * deltaTime;
+				totalYaw += mouseX * rotationInterval * deltaTime;
 			}
 		}
 		else if (RightMouseButtonDown)
 		{
-			totalYaw += float(mouseX) * rotationInterval * deltaTime;
-			totalPitch += float(mouseY) * rotationInterval * deltaTime;
+			totalYaw += mouseX * rotationInterval * deltaTime;
+			totalPitch += mouseY * rotationInterval * deltaTime;
 		}
 
 		Matrix finalRotation{ Matrix::CreateRotation(totalPitch, totalYaw, 0.0f) };
 		forward = finalRotation.TransformVector(Vector3::UnitZ);
 		forward.Normalize();
+
+		if (origin.x != previousOrigin.x || origin.y != previousOrigin.y || origin.z != previousOrigin.z || totalPitch != previousPitch || totalYaw != previousYaw)
+		{
+			++version;
+		}
 	}
 }
\ No newline at end of file
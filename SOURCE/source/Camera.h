@@ -1,7 +1,5 @@
 #pragma once
 #include <cassert>
-#include <SDL_keyboard.h>
-#include <SDL_mouse.h>
 #include <iostream>
 
 #pragma once
@@ -10,6 +8,21 @@
 
 namespace dae
 {
+	/**
+	 * \brief Input state the camera reacts to, filled in by the windowed app every frame and left empty when running headless
+	 */
+	struct CameraInput
+	{
+		bool moveForward;
+		bool moveBackward;
+		bool moveRight;
+		bool moveLeft;
+		bool leftMouseButton;
+		bool rightMouseButton;
+		int mouseX;		// Relative mouse motion since the last frame
+		int mouseY;
+	};
+
 	struct Camera final
 	{
 		Camera();
@@ -32,5 +45,7 @@ namespace dae
 		float totalPitch;
 		float totalYaw;
 		Matrix cameraToWorld;
+		CameraInput input;
+		uint32_t version;	// Bumped by Update whenever the camera moved or turned, code that sets origin or fovAngle directly should bump it as well
 	};
 }
@@ -1,65 +1,123 @@
 #pragma once
+#include <algorithm>
+#include "MathHelpers.h"
 
 namespace dae
 {
+	// Header only, so the per light accumulation in the pixel kernel inlines
 	struct ColorRGB
 	{
-		static ColorRGB Lerp(const ColorRGB& c1, const ColorRGB& c2, float factor);
+		static constexpr ColorRGB Lerp(const ColorRGB& c1, const ColorRGB& c2, float factor)
+		{
+			return { Lerpf(c1.r, c2.r, factor), Lerpf(c1.g, c2.g, factor), Lerpf(c1.b, c2.b, factor) };
+		}
 
-		void MaxToOne();
+		constexpr void MaxToOne()
+		{
+			const float maxValue = std::max(r, std::max(g, b));
+			if (maxValue > 1.f)
+				*this /= maxValue;
+		}
 
-		ColorRGB& operator+=(const ColorRGB& c);
-		ColorRGB& operator-=(const ColorRGB& c);
-		ColorRGB& operator*=(const ColorRGB& c);
-		ColorRGB& operator*=(float s);
-		ColorRGB& operator/=(const ColorRGB& c);
-		ColorRGB& operator/=(float s);
+		constexpr ColorRGB& operator+=(const ColorRGB& c)
+		{
+			r += c.r;
+			g += c.g;
+			b += c.b;
+
+			return *this;
+		}
+
+		constexpr ColorRGB& operator-=(const ColorRGB& c)
+		{
+			r -= c.r;
+			g -= c.g;
+			b -= c.b;
+
+			return *this;
+		}
+
+		constexpr ColorRGB& operator*=(const ColorRGB& c)
+		{
+			r *= c.r;
+			g *= c.g;
+			b *= c.b;
+
+			return *this;
+		}
+
+		constexpr ColorRGB& operator*=(float s)
+		{
+			r *= s;
+			g *= s;
+			b *= s;
+
+			return *this;
+		}
+
+		constexpr ColorRGB& operator/=(const ColorRGB& c)
+		{
+			r /= c.r;
+			g /= c.g;
+			b /= c.b;
+
+			return *this;
+		}
+
+		constexpr ColorRGB& operator/=(float s)
+		{
+			r /= s;
+			g /= s;
+			b /= s;
+
+			return *this;
+		}
 
 		float r;
 		float g;
 		float b;
 	};
 
-	inline ColorRGB operator*(float lhs, const ColorRGB& rhs)
+	constexpr ColorRGB operator*(float lhs, const ColorRGB& rhs)
 	{
 		return ColorRGB{ lhs * rhs.r, lhs * rhs.g, lhs * rhs.b };
 	}
 
-	inline ColorRGB operator*(const ColorRGB& lhs, float rhs)
+	constexpr ColorRGB operator*(const ColorRGB& lhs, float rhs)
 	{
 		return ColorRGB{ lhs.r * rhs, lhs.g * rhs, lhs.b * rhs };
 	}
 
-	inline ColorRGB operator*(const ColorRGB& lhs, const ColorRGB& rhs)
+	constexpr ColorRGB operator*(const ColorRGB& lhs, const ColorRGB& rhs)
 	{
 		return ColorRGB{ lhs.r * rhs.r, lhs.g * rhs.g, lhs.b * rhs.b };
 	}
 
-	inline ColorRGB operator/(const ColorRGB& lhs, float rhs)
+	constexpr ColorRGB operator/(const ColorRGB& lhs, float rhs)
 	{
 		return ColorRGB{ lhs.r / rhs, lhs.g / rhs, lhs.b / rhs };
 	}
 
-	inline ColorRGB operator+(const ColorRGB& lhs, const ColorRGB& rhs)
+	constexpr ColorRGB operator+(const ColorRGB& lhs, const ColorRGB& rhs)
 	{
 		return ColorRGB{ lhs.r + rhs.r, lhs.g + rhs.g, lhs.b + rhs.b };
 	}
 
-	inline ColorRGB operator-(const ColorRGB& lhs, const ColorRGB& rhs)
+	constexpr ColorRGB operator-(const ColorRGB& lhs, const ColorRGB& rhs)
 	{
 		return ColorRGB{ lhs.r - rhs.r, lhs.g - rhs.g, lhs.b - rhs.b };
 	}
 
 	namespace colors
 	{
-		static ColorRGB Red{ 1.0f,0.0f,0.0f };
-		static ColorRGB Blue{ 0.0f,0.0f,1.0f };
-		static ColorRGB Green{ 0.0f,1.0f,0.0f };
-		static ColorRGB Yellow{ 1.0f,1.0f,0.0f };
-		static ColorRGB Cyan{ 0.0f,1.0f,1.0f };
-		static ColorRGB Magenta{ 1.0f,0.0f,1.0f };
-		static ColorRGB White{ 1.0f,1.0f,1.0f };
-		static ColorRGB Black{ 0.0f,0.0f,0.0f };
-		static ColorRGB Gray{ 0.5f,0.5f,0.5f };
+		inline constexpr ColorRGB Red{ 1.0f,0.0f,0.0f };
+		inline constexpr ColorRGB Blue{ 0.0f,0.0f,1.0f };
+		inline constexpr ColorRGB Green{ 0.0f,1.0f,0.0f };
+		inline constexpr ColorRGB Yellow{ 1.0f,1.0f,0.0f };
+		inline constexpr ColorRGB Cyan{ 0.0f,1.0f,1.0f };
+		inline constexpr ColorRGB Magenta{ 1.0f,0.0f,1.0f };
+		inline constexpr ColorRGB White{ 1.0f,1.0f,1.0f };
+		inline constexpr ColorRGB Black{ 0.0f,0.0f,0.0f };
+		inline constexpr ColorRGB Gray{ 0.5f,0.5f,0.5f };
 	}
 }
\ No newline at end of file
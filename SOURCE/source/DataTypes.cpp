@@ -2,6 +2,8 @@
 
 // Project includes
 #include "DataTypes.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
 
 namespace dae
 {
@@ -41,8 +43,11 @@ namespace dae
 		minAABB{},
 		maxAABB{},
 		transformedMinAABB{},
-		transformedMaxAABB{}
+		transformedMaxAABB{},
+		bvh{},
+		bvhUpdateMode{ BVHUpdateMode::Refit }
 	{
+		bvh.leafBatchSize = TriangleBlock::Width;
 
 	}
 
@@ -60,8 +65,11 @@ namespace dae
 		minAABB{},
 		maxAABB{},
 		transformedMinAABB{},
-		transformedMaxAABB{}
+		transformedMaxAABB{},
+		bvh{},
+		bvhUpdateMode{ BVHUpdateMode::Refit }
 	{
+		bvh.leafBatchSize = TriangleBlock::Width;
 		CalculateNormals();
 		UpdateAABB();
 		UpdateTransforms();
@@ -81,8 +89,11 @@ namespace dae
 		minAABB{},
 		maxAABB{},
 		transformedMinAABB{},
-		transformedMaxAABB{}
+		transformedMaxAABB{},
+		bvh{},
+		bvhUpdateMode{ BVHUpdateMode::Refit }
 	{
+		bvh.leafBatchSize = TriangleBlock::Width;
 		UpdateAABB();
 		UpdateTransforms();
 	}
@@ -133,8 +144,10 @@ namespace dae
 		}
 	}
 
-	void TriangleMesh::UpdateTransforms()
+	void TriangleMesh::UpdateTransforms(ThreadPool* pThreadPool)
 	{
+		PROFILE_ZONE("TriangleMesh::UpdateTransforms");
+
 		if (positions.size() != transformedPositions.size() || normals.size() != transformedNormals.size())
 		{
 			transformedPositions = positions;
@@ -143,17 +156,27 @@ namespace dae
 
 		const Matrix finalTransform{ scaleTransform * rotationTransform * translationTransform };
 
-		for (int index{ 0 }; index < positions.size(); index++)
-		{
-			transformedPositions[index] = finalTransform.TransformPoint(positions[index]);
-		}
-
-		for (int index{ 0 }; index < normals.size(); index++)
-		{
-			transformedNormals[index] = finalTransform.TransformVector(normals[index]);
-		}
+		ParallelFor(pThreadPool, uint32_t(positions.size()), [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t index{ begin }; index < end; index++)
+				{
+					transformedPositions[index] = finalTransform.TransformPoint(positions[index]);
+				}
+			}, TransformGrainSize
+		);
+
+		ParallelFor(pThreadPool, uint32_t(normals.size()), [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t index{ begin }; index < end; index++)
+				{
+					transformedNormals[index] = finalTransform.TransformVector(normals[index]);
+				}
+			}, TransformGrainSize
+		);
 
 		UpdateTranformedAABB(finalTransform);
+		UpdatePrecomputedTriangles(transformedPositions, pThreadPool);
+		UpdateBVH();
 	}
 
 	void TriangleMesh::UpdateAABB()
@@ -216,6 +239,168 @@ namespace dae
 		transformedMaxAABB = tMaxAABB;
 	}
 
+	void TriangleMesh::UpdateBVH()
+	{
+		PROFILE_ZONE("TriangleMesh::UpdateBVH");
+
+		const bool topologyChanged{ bvh.primitiveIndices.size() != indices.size() / 3 };
+
+		// Refitting keeps the tree layout and only grows the boxes, once they got too loose the tree is rebuilt
+		if (bvhUpdateMode == BVHUpdateMode::Refit && !topologyChanged && !bvh.nodes.empty())
+		{
+			bvh.Refit(transformedPositions, indices);
+
+			if (!bvh.NeedsRebuild())
+			{
+				UpdateTriangleBlocks();
+				wideBVH.Build(bvh);
+				return;
+			}
+		}
+
+		bvh.Build(transformedPositions, indices);
+		UpdateTriangleBlocks();
+		wideBVH.Build(bvh);
+	}
+
+	void TriangleMesh::UpdatePrecomputedTriangles(const std::vector<Vector3>& sourcePositions, ThreadPool* pThreadPool)
+	{
+		precomputedTriangles.resize(indices.size() / 3);
+
+		ParallelFor(pThreadPool, uint32_t(precomputedTriangles.size()), [&](uint32_t begin, uint32_t end)
+			{
+				for (size_t index{ begin }; index < end; ++index)
+				{
+					const Vector3& v0{ sourcePositions[indices[index * 3]] };
+
+					precomputedTriangles[index].v0 = v0;
+					precomputedTriangles[index].edge1 = sourcePositions[indices[index * 3 + 1]] - v0;
+					precomputedTriangles[index].edge2 = sourcePositions[indices[index * 3 + 2]] - v0;
+				}
+			}, TransformGrainSize
+		);
+	}
+
+	void TriangleMesh::UpdateTriangleBlocks()
+	{
+		triangleBlocks.clear();
+		leafBlockOffsets.assign(bvh.nodes.size(), 0);
+
+		for (size_t nodeIndex{}; nodeIndex < bvh.nodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node{ bvh.nodes[nodeIndex] };
+			if (!node.IsLeaf()) continue;
+
+			leafBlockOffsets[nodeIndex] = static_cast<uint32_t>(triangleBlocks.size());
+
+			for (uint32_t first{}; first < node.primitiveCount; first += TriangleBlock::Width)
+			{
+				TriangleBlock& block{ triangleBlocks.emplace_back(TriangleBlock{}) };
+
+				for (uint32_t lane{}; lane < TriangleBlock::Width && first + lane < node.primitiveCount; ++lane)
+				{
+					const uint32_t triangleIndex{ bvh.primitiveIndices[node.leftFirst + first + lane] };
+					const PrecomputedTriangle& triangle{ precomputedTriangles[triangleIndex] };
+
+					block.v0x[lane] = triangle.v0.x;
+					block.v0y[lane] = triangle.v0.y;
+					block.v0z[lane] = triangle.v0.z;
+					block.edge1x[lane] = triangle.edge1.x;
+					block.edge1y[lane] = triangle.edge1.y;
+					block.edge1z[lane] = triangle.edge1.z;
+					block.edge2x[lane] = triangle.edge2.x;
+					block.edge2y[lane] = triangle.edge2.y;
+					block.edge2z[lane] = triangle.edge2.z;
+					block.triangleIndices[lane] = triangleIndex;
+				}
+			}
+		}
+	}
+
+	void TriangleMesh::PrepareForInstancing()
+	{
+		// Instances transform rays into object space, so the mesh keeps no transformed copy of its geometry
+		transformedPositions.clear();
+		transformedPositions.shrink_to_fit();
+		transformedNormals.clear();
+		transformedNormals.shrink_to_fit();
+
+		UpdateAABB();
+		UpdatePrecomputedTriangles(positions);
+		bvh.Build(positions, indices);
+		UpdateTriangleBlocks();
+		wideBVH.Build(bvh);
+	}
+
+	MeshInstance::MeshInstance() :
+		pMesh{ nullptr },
+		materialIndex{},
+		rotationTransform{},
+		translationTransform{},
+		scaleTransform{},
+		objectToWorld{},
+		worldToObject{},
+		minAABB{},
+		maxAABB{}
+	{
+
+	}
+
+	MeshInstance::MeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, unsigned char materialIndex) :
+		pMesh{ pMesh },
+		materialIndex{ materialIndex },
+		rotationTransform{},
+		translationTransform{},
+		scaleTransform{},
+		objectToWorld{},
+		worldToObject{},
+		minAABB{},
+		maxAABB{}
+	{
+		UpdateTransforms();
+	}
+
+	void MeshInstance::Translate(const Vector3& translation)
+	{
+		translationTransform = Matrix::CreateTranslation(translation);
+	}
+
+	void MeshInstance::RotateY(float yaw)
+	{
+		rotationTransform = Matrix::CreateRotationY(yaw);
+	}
+
+	void MeshInstance::Scale(const Vector3& scale)
+	{
+		scaleTransform = Matrix::CreateScale(scale);
+	}
+
+	void MeshInstance::UpdateTransforms()
+	{
+		objectToWorld = scaleTransform * rotationTransform * translationTransform;
+		worldToObject = Matrix::Inverse(objectToWorld);
+
+		if (!pMesh || pMesh->bvh.nodes.empty()) return;
+
+		// World bounds of the object space BVH root, only the 8 corners get transformed
+		const Vector3& objectMin{ pMesh->bvh.nodes[0].minAABB };
+		const Vector3& objectMax{ pMesh->bvh.nodes[0].maxAABB };
+
+		minAABB = objectToWorld.TransformPoint(objectMin);
+		maxAABB = minAABB;
+
+		for (int corner{ 1 }; corner < 8; ++corner)
+		{
+			const Vector3 point{ objectToWorld.TransformPoint(
+				(corner & 1) ? objectMax.x : objectMin.x,
+				(corner & 2) ? objectMax.y : objectMin.y,
+				(corner & 4) ? objectMax.z : objectMin.z) };
+
+			minAABB = Vector3::Min(minAABB, point);
+			maxAABB = Vector3::Max(maxAABB, point);
+		}
+	}
+
 	Ray::Ray() :
 		origin{ Vector3::Zero },
 		direction{ Vector3::Zero },
@@ -234,6 +419,18 @@ namespace dae
 
 	}
 
+	RayPacket::RayPacket() :
+		directionX{},
+		directionY{},
+		directionZ{},
+		origin{ Vector3::Zero },
+		min{ 0.0001f },
+		max{ FLT_MAX },
+		activeMask{ 0 }
+	{
+
+	}
+
 	HitRecord::HitRecord() :
 		origin{ Vector3::Zero },
 		normal{ Vector3::Zero },
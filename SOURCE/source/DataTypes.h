@@ -2,12 +2,18 @@
 
 // External includes
 #include <vector>
+#include <memory>
+#include <cstdint>
 
 // Project includes
 #include "Math.h"
+#include "BVH.h"
 
 namespace dae
 {
+	// Forward Declerations
+	class ThreadPool;
+
 	struct Sphere
 	{
 		Vector3 origin;
@@ -29,6 +35,12 @@ namespace dae
 		NoCulling
 	};
 
+	enum class BVHUpdateMode
+	{
+		Rebuild,
+		Refit
+	};
+
 	struct Triangle
 	{
 		Triangle() = default;
@@ -43,8 +55,40 @@ namespace dae
 		unsigned char materialIndex;
 	};
 
+	/**
+	 * \brief Triangle laid out for the Möller–Trumbore test, the edges are computed once per transform update instead of per ray
+	 */
+	struct PrecomputedTriangle
+	{
+		Vector3 v0;
+		Vector3 edge1;		// v1 - v0
+		Vector3 edge2;		// v2 - v0
+	};
+
+	/**
+	 * \brief Up to 8 mesh triangles in structure of arrays layout, so one ray can be tested against all of them at once
+	 * Unused lanes hold degenerate triangles, which every cull mode rejects
+	 */
+	struct alignas(32) TriangleBlock
+	{
+		static constexpr uint32_t Width{ 8 };
+
+		float v0x[Width];
+		float v0y[Width];
+		float v0z[Width];
+		float edge1x[Width];
+		float edge1y[Width];
+		float edge1z[Width];
+		float edge2x[Width];
+		float edge2y[Width];
+		float edge2z[Width];
+		uint32_t triangleIndices[Width];
+	};
+
 	struct TriangleMesh
 	{
+		static constexpr uint32_t TransformGrainSize{ 1024 };	// Vertices or triangles per task when a transform update is spread over a thread pool
+
 		TriangleMesh();
 		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode);
 		TriangleMesh(const std::vector<Vector3>& positions, const std::vector<int>& indices, const std::vector<Vector3>& normals, TriangleCullMode cullMode);
@@ -54,9 +98,13 @@ namespace dae
 		void Scale(const Vector3& scale);
 		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false);
 		void CalculateNormals();
-		void UpdateTransforms();
+		void UpdateTransforms(ThreadPool* pThreadPool = nullptr);
 		void UpdateAABB();
 		void UpdateTranformedAABB(const Matrix& finalTransform);
+		void UpdateBVH();
+		void UpdatePrecomputedTriangles(const std::vector<Vector3>& sourcePositions, ThreadPool* pThreadPool = nullptr);
+		void UpdateTriangleBlocks();
+		void PrepareForInstancing();
 
 		std::vector<Vector3> positions;
 		std::vector<Vector3> normals;
@@ -72,6 +120,38 @@ namespace dae
 		Vector3 maxAABB;
 		Vector3 transformedMinAABB;
 		Vector3 transformedMaxAABB;
+		std::vector<PrecomputedTriangle> precomputedTriangles;	// Per triangle, in the same space as the BVH
+		std::vector<TriangleBlock> triangleBlocks;				// The triangles of every BVH leaf, packed leaf after leaf
+		std::vector<uint32_t> leafBlockOffsets;					// Per BVH node, index of the first block of the leaf
+		BVH bvh;
+		WideBVH wideBVH;			// Collapsed from bvh after every build or refit, this is the one rays traverse
+		BVHUpdateMode bvhUpdateMode;
+	};
+
+	/**
+	 * \brief Placement of a shared, immutable mesh in the world
+	 * Rays are transformed into the object space of the mesh instead of transforming its vertices, so moving an instance is O(1)
+	 * and every instance of the same mesh shares its geometry and BVH
+	 */
+	struct MeshInstance
+	{
+		MeshInstance();
+		MeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, unsigned char materialIndex);
+
+		void Translate(const Vector3& translation);
+		void RotateY(float yaw);
+		void Scale(const Vector3& scale);
+		void UpdateTransforms();
+
+		std::shared_ptr<const TriangleMesh> pMesh;
+		unsigned char materialIndex;
+		Matrix rotationTransform;
+		Matrix translationTransform;
+		Matrix scaleTransform;
+		Matrix objectToWorld;
+		Matrix worldToObject;
+		Vector3 minAABB;
+		Vector3 maxAABB;
 	};
 
 	enum class LightType
@@ -100,6 +180,27 @@ namespace dae
 		float max;
 	};
 
+	/**
+	 * \brief 8 rays that share their origin, traced together with one SIMD lane per ray
+	 * Camera rays of a 4 by 2 pixel block with lane = column + 4 * row, the corner lanes 0, 3, 4 and 7 span the frustum the whole packet is culled with
+	 */
+	struct alignas(32) RayPacket
+	{
+		static constexpr uint32_t Width{ 8 };
+		static constexpr uint32_t Columns{ 4 };
+		static constexpr uint32_t Rows{ Width / Columns };
+
+		RayPacket();
+
+		float directionX[Width];
+		float directionY[Width];
+		float directionZ[Width];
+		Vector3 origin;
+		float min;
+		float max;
+		uint32_t activeMask;	// One bit per lane, lanes past the edge of the image repeat a valid direction but are never hit
+	};
+
 	struct HitRecord
 	{
 		HitRecord();
@@ -0,0 +1,71 @@
+#include "Framebuffer.h"
+#include <fstream>
+
+namespace dae
+{
+	namespace
+	{
+		void WriteLittleEndian(std::ofstream& file, uint32_t value, uint32_t byteCount)
+		{
+			for (uint32_t byte{}; byte < byteCount; ++byte)
+			{
+				file.put(char((value >> (8 * byte)) & 0xFF));
+			}
+		}
+	}
+
+	Framebuffer::Framebuffer(uint32_t width, uint32_t height) :
+		width{ width },
+		height{ height },
+		pixels(size_t(width) * height, 0)
+	{
+	}
+
+	bool Framebuffer::SaveBMP(const std::string& filename) const
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		// 24 bit BMP, rows are stored bottom to top and padded to a multiple of 4 bytes
+		const uint32_t rowSize{ (width * 3 + 3) & ~3u };
+		const uint32_t imageSize{ rowSize * height };
+		const uint32_t headerSize{ 14 + 40 };
+
+		// File header
+		file.put('B');
+		file.put('M');
+		WriteLittleEndian(file, headerSize + imageSize, 4);
+		WriteLittleEndian(file, 0, 4);
+		WriteLittleEndian(file, headerSize, 4);
+
+		// Info header
+		WriteLittleEndian(file, 40, 4);
+		WriteLittleEndian(file, width, 4);
+		WriteLittleEndian(file, height, 4);
+		WriteLittleEndian(file, 1, 2);
+		WriteLittleEndian(file, 24, 2);
+		WriteLittleEndian(file, 0, 4);
+		WriteLittleEndian(file, imageSize, 4);
+		WriteLittleEndian(file, 2835, 4);
+		WriteLittleEndian(file, 2835, 4);
+		WriteLittleEndian(file, 0, 4);
+		WriteLittleEndian(file, 0, 4);
+
+		std::vector<char> row(rowSize, 0);
+		for (uint32_t y{ height }; y-- > 0;)
+		{
+			for (uint32_t x{}; x < width; ++x)
+			{
+				const uint32_t pixel{ pixels[size_t(y) * width + x] };
+				row[x * 3] = char(pixel & 0xFF);
+				row[x * 3 + 1] = char((pixel >> 8) & 0xFF);
+				row[x * 3 + 2] = char((pixel >> 16) & 0xFF);
+			}
+
+			file.write(row.data(), rowSize);
+		}
+
+		return bool(file);
+	}
+}
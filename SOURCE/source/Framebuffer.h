@@ -0,0 +1,26 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Plain in-memory color buffer the renderer writes to, one 0x00RRGGBB pixel per element, rows top to bottom
+	 * Presenting it is up to the owner: the SDL app copies it to the window surface, the headless app writes it to disk
+	 */
+	struct Framebuffer
+	{
+		Framebuffer(uint32_t width, uint32_t height);
+
+		static uint32_t PackRGB(uint8_t r, uint8_t g, uint8_t b) { return (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b); }
+
+		bool SaveBMP(const std::string& filename) const;
+
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint32_t> pixels;
+	};
+}
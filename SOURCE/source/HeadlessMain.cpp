@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Timer.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+
+// Renders a fixed number of frames of one scene without opening a window and writes them to disk as BMP files
+// Usage: RayTracerHeadless --scene W4_ExtraScene --frames 60 [--width 640] [--height 480] [--threads 0] [--pin] [--tile 16] [--dt 0.0333] [--output frame] [--trace trace.json] [--heatmap] [--sorted] [--single-rays] [--wavefront] [--skip-unchanged] [--dirty-tiles] [--target-ms 16.6]
+// or runs the batch benchmark over every scene and writes the results as JSON
+// Usage: RayTracerHeadless --benchmark results.json [--frames 30] [--threads 0] [--dt 0.0333]
+
+namespace
+{
+	struct HeadlessSettings
+	{
+		std::string sceneName{ "W4_ReferenceScene" };
+		std::string outputPrefix{ "frame" };
+		std::string benchmarkFile{};
+		std::string traceFile{};	// Chrome trace of every frame, needs a build with RAYTRACER_PROFILING
+		uint32_t frameCount{ 0 };	// 0 renders 1 frame, or 30 per run in benchmark mode
+		uint32_t width{ 640 };
+		uint32_t height{ 480 };
+		uint32_t threadCount{ 0 };
+		uint32_t tileSize{ 16 };
+		float timeStep{ 1.0f / 30.0f };
+		float targetFrameMs{ 0.0f };	// Dynamic resolution, picks the render resolution of every frame from the render times so far, 0 renders at full size
+		bool pinThreads{ false };
+		bool sortedShading{ false };	// Material sorted two pass shading
+		bool singleRays{ false };		// Camera rays one at a time instead of in packets
+		bool wavefront{ false };		// Whole frame passes with sorted shadow ray streams
+		bool skipUnchanged{ false };	// Keeps the previous image when neither the scene nor the camera changed, like the windowed app
+		bool dirtyTiles{ false };		// Redraws only the tiles moved objects and their shadows cover while the camera stands still, like the windowed app
+		bool costHeatmap{ false };	// Writes the per pixel cost heatmap instead of the image, and the raw cost buffer next to it
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerHeadless --scene <name> --frames <count> [--width <px>] [--height <px>] [--threads <count, 0 = all>] [--pin] "
+			"[--tile <px>] [--dt <seconds per frame>] [--output <file prefix>] [--trace <json file>] [--heatmap] [--sorted] [--single-rays] [--wavefront] [--skip-unchanged] [--dirty-tiles] [--target-ms <frame time>]\n"
+			"       RayTracerHeadless --benchmark <json file> [--frames <count per run>] [--threads <count, 0 = all>] [--dt <seconds per frame>]\nScenes:";
+
+		for (const std::string& name : dae::GetSceneNames()) std::cout << " " << name;
+		std::cout << std::endl;
+	}
+
+	bool ParseArguments(int argc, char* args[], HeadlessSettings& settings)
+	{
+		for (int index{ 1 }; index < argc; ++index)
+		{
+			const std::string argument{ args[index] };
+			const bool hasValue{ index + 1 < argc };
+
+			if (argument == "--pin") settings.pinThreads = true;
+			else if (argument == "--heatmap") settings.costHeatmap = true;
+			else if (argument == "--sorted") settings.sortedShading = true;
+			else if (argument == "--single-rays") settings.singleRays = true;
+			else if (argument == "--wavefront") settings.wavefront = true;
+			else if (argument == "--skip-unchanged") settings.skipUnchanged = true;
+			else if (argument == "--dirty-tiles") settings.dirtyTiles = true;
+			else if (argument == "--scene" && hasValue) settings.sceneName = args[++index];
+			else if (argument == "--output" && hasValue) settings.outputPrefix = args[++index];
+			else if (argument == "--benchmark" && hasValue) settings.benchmarkFile = args[++index];
+			else if (argument == "--trace" && hasValue) settings.traceFile = args[++index];
+			else if (argument == "--frames" && hasValue) settings.frameCount = uint32_t(std::strtoul(args[++index], nullptr, 10));
+			else if (argument == "--width" && hasValue) settings.width = uint32_t(std::strtoul(args[++index], nullptr, 10));
+			else if (argument == "--height" && hasValue) settings.height = uint32_t(std::strtoul(args[++index], nullptr, 10));
+			else if (argument == "--threads" && hasValue) settings.threadCount = uint32_t(std::strtoul(args[++index], nullptr, 10));
+			else if (argument == "--tile" && hasValue) settings.tileSize = uint32_t(std::strtoul(args[++index], nullptr, 10));
+			else if (argument == "--dt" && hasValue) settings.timeStep = std::strtof(args[++index], nullptr);
+			else if (argument == "--target-ms" && hasValue) settings.targetFrameMs = std::strtof(args[++index], nullptr);
+			else return false;
+		}
+
+		return settings.width > 0 && settings.height > 0;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	HeadlessSettings settings{};
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (!settings.benchmarkFile.empty())
+	{
+		std::ofstream json{ settings.benchmarkFile };
+		if (!json)
+		{
+			std::cout << "Could not write " << settings.benchmarkFile << std::endl;
+			return 1;
+		}
+
+		dae::Benchmark::SceneBatch(json, settings.frameCount > 0 ? settings.frameCount : 30, settings.timeStep, settings.threadCount);
+		return 0;
+	}
+
+	settings.frameCount = std::max(1u, settings.frameCount);
+
+	std::unique_ptr<dae::Scene> pScene{ dae::CreateScene(settings.sceneName) };
+	if (!pScene)
+	{
+		std::cout << "Unknown scene: " << settings.sceneName << std::endl;
+		PrintUsage();
+		return 1;
+	}
+
+	dae::Timer timer{};
+	dae::Renderer renderer{ settings.width, settings.height };
+	renderer.GetThreadPool().Resize(settings.threadCount, settings.pinThreads);
+	renderer.SetTileSize(settings.tileSize);
+	renderer.SetSortedShadingEnabled(settings.sortedShading);
+	renderer.SetPacketTracingEnabled(!settings.singleRays);
+	renderer.SetWavefrontEnabled(settings.wavefront);
+	renderer.SetDirtyTilesEnabled(settings.dirtyTiles);
+	if (settings.costHeatmap) renderer.ToggleCostHeatmap();
+
+	pScene->SetThreadPool(&renderer.GetThreadPool());
+	pScene->Initialize();
+	timer.SetFixedTimeStep(settings.timeStep);
+	timer.SetTargetFrameTime(settings.targetFrameMs / 1000.0f);
+	timer.Start();
+
+	if (!settings.traceFile.empty()) dae::Profiler::BeginCapture();
+	double totalRenderMs{};
+	uint32_t skippedFrameCount{};
+	double totalTileFraction{};
+	double totalResolutionScale{};
+
+	for (uint32_t frame{}; frame < settings.frameCount; ++frame)
+	{
+		PROFILE_ZONE("Frame");
+		{
+			PROFILE_ZONE("Scene::Update");
+			pScene->Update(&timer);
+		}
+		renderer.SetScene(pScene.get());
+
+		renderer.SetResolutionScale(timer.GetResolutionScale());
+
+		const bool skipFrame{ settings.skipUnchanged && !renderer.IsFrameOutdated() };
+		const auto renderStart{ std::chrono::steady_clock::now() };
+		if (!skipFrame)
+		{
+			pScene->UpdateTopLevelBVH();
+			renderer.Render();
+		}
+		const double renderMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count() };
+		totalRenderMs += renderMs;
+		skippedFrameCount += skipFrame ? 1 : 0;
+		const float tileFraction{ skipFrame ? 0.0f : renderer.GetRenderedTileFraction() };
+		totalTileFraction += tileFraction;
+		totalResolutionScale += renderer.GetResolutionScale();
+		if (!skipFrame) timer.UpdateResolutionScale(float(renderMs / 1000.0));
+
+		timer.Update();
+
+		char filename[32]{};
+		std::snprintf(filename, sizeof(filename), "_%04u.bmp", frame);
+		PROFILE_ZONE("Framebuffer::SaveBMP");
+		if (!renderer.GetFramebuffer().SaveBMP(settings.outputPrefix + filename))
+		{
+			std::cout << "Could not write " << settings.outputPrefix + filename << std::endl;
+			return 1;
+		}
+
+		std::snprintf(filename, sizeof(filename), "_%04u.cost", frame);
+		if (settings.costHeatmap && !renderer.SaveCostBuffer(settings.outputPrefix + filename))
+		{
+			std::cout << "Could not write " << settings.outputPrefix + filename << std::endl;
+			return 1;
+		}
+
+		std::cout << "Frame " << frame << ": " << renderMs << " ms, " << tileFraction * 100.0f << "% of the tiles";
+		if (timer.IsDynamicResolutionEnabled()) std::cout << " at " << renderer.GetRenderWidth() << "x" << renderer.GetRenderHeight();
+		std::cout << (skipFrame ? ", skipped as nothing changed" : "") << std::endl;
+	}
+
+	std::cout << settings.sceneName << ", " << settings.frameCount << " frames at " << settings.width << "x" << settings.height << " on "
+		<< renderer.GetThreadCount() << " threads: " << totalRenderMs / settings.frameCount << " ms per frame, " << totalTileFraction * 100.0 / settings.frameCount
+		<< "% of the tiles rendered";
+	if (settings.skipUnchanged) std::cout << ", " << skippedFrameCount << " frames skipped";
+	if (timer.IsDynamicResolutionEnabled()) std::cout << ", average resolution scale " << totalResolutionScale / settings.frameCount << " for a " << settings.targetFrameMs << " ms target";
+	std::cout << std::endl;
+
+	if (!settings.traceFile.empty())
+	{
+		dae::Profiler::EndCapture();
+		if (!dae::Profiler::WriteChromeTrace(settings.traceFile))
+		{
+			std::cout << "Could not write " << settings.traceFile << std::endl;
+			return 1;
+		}
+	}
+
+	timer.Stop();
+	return 0;
+}
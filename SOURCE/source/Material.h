@@ -1,77 +1,51 @@
 #pragma once
+#include <variant>
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
 
 namespace dae
 {
-	class Material
-	{
-		public:
-			Material() = default;
-			virtual ~Material() = default;
-
-			Material(const Material&) = delete;
-			Material(Material&&) noexcept = delete;
-			Material& operator=(const Material&) = delete;
-			Material& operator=(Material&&) noexcept = delete;
-
-			virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const = 0;
-
-		protected:
-
-
-		private:
-
-	};
+	// Plain value types stored by value in one Material table, Shade is defined here so it can inline into the pixel kernel
 
-	class Material_SolidColor final : public Material
+	class Material_SolidColor final
 	{
 		public:
 			Material_SolidColor(const ColorRGB& color);
-			virtual ~Material_SolidColor() = default;
-
-			Material_SolidColor(const Material_SolidColor&) = delete;
-			Material_SolidColor(Material_SolidColor&&) noexcept = delete;
-			Material_SolidColor& operator=(const Material_SolidColor&) = delete;
-			Material_SolidColor& operator=(Material_SolidColor&&) noexcept = delete;
 
-			virtual ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const override;
+			ColorRGB Shade(const HitRecord&, const Vector3&, const Vector3&) const
+			{
+				return m_Color;
+			}
 
 		private:
 			ColorRGB m_Color;
 	};
 
-	class Material_Lambert final : public Material
+	class Material_Lambert final
 	{
 		public:
 			Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance);
-			virtual ~Material_Lambert() = default;
-
-			Material_Lambert(const Material_Lambert&) = delete;
-			Material_Lambert(Material_Lambert&&) noexcept = delete;
-			Material_Lambert& operator=(const Material_Lambert&) = delete;
-			Material_Lambert& operator=(Material_Lambert&&) noexcept = delete;
 
-			virtual ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const override;
+			ColorRGB Shade(const HitRecord&, const Vector3&, const Vector3&) const
+			{
+				return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
+			}
 
 		private:
 			ColorRGB m_DiffuseColor;
 			float m_DiffuseReflectance;
 	};
 
-	class Material_LambertPhong final : public Material
+	class Material_LambertPhong final
 	{
 		public:
 			Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent);
-			virtual ~Material_LambertPhong() = default;
 
-			Material_LambertPhong(const Material_LambertPhong&) = delete;
-			Material_LambertPhong(Material_LambertPhong&&) noexcept = delete;
-			Material_LambertPhong& operator=(const Material_LambertPhong&) = delete;
-			Material_LambertPhong& operator=(Material_LambertPhong&&) noexcept = delete;
-
-			virtual ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const override;
+			ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+			{
+				return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, v, hitRecord.normal);
+			}
 
 		private:
 			ColorRGB m_DiffuseColor;
@@ -80,22 +54,43 @@ namespace dae
 			float m_PhongExponent;
 	};
 
-	class Material_CookTorrence final : public Material
+	class Material_CookTorrence final
 	{
 		public:
 			Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness);
-			virtual ~Material_CookTorrence() = default;
 
-			Material_CookTorrence(const Material_CookTorrence&) = delete;
-			Material_CookTorrence(Material_CookTorrence&&) noexcept = delete;
-			Material_CookTorrence& operator=(const Material_CookTorrence&) = delete;
-			Material_CookTorrence& operator=(Material_CookTorrence&&) noexcept = delete;
+			ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+			{
+				const Vector3 h{ (v + l).Normalized() };
+				const ColorRGB f0{ (AreEqual(m_Metalness, 0.0f)) ? ColorRGB{ 0.04f, 0.04f, 0.04f } : m_Albedo };
+
+				const ColorRGB F{ BRDF::FresnelFunction_Schlick(h, v, f0) };
+				const float D{ BRDF::NormalDistribution_GGX(hitRecord.normal, h, m_Roughness) };
+				const float G{ BRDF::GeometryFunction_Smith(hitRecord.normal, v, l, m_Roughness) };
 
-			virtual ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const override;
+				const ColorRGB specular{ (D * F * G) / (4 * Vector3::Dot(v, hitRecord.normal) * Vector3::Dot(l, hitRecord.normal)) };
+				const ColorRGB kd{ (AreEqual(m_Metalness, 1.0f)) ? colors::Black : colors::White - F };
+				const ColorRGB diffuse{ BRDF::Lambert(kd, m_Albedo) };
+
+				return diffuse + specular;
+			}
 
 		private:
 			ColorRGB m_Albedo;
 			float m_Metalness;
 			float m_Roughness;
 	};
+
+	/**
+	 * \brief Any of the material types, the scene keeps them in one contiguous vector instead of separate heap objects behind a virtual Shade
+	 */
+	using Material = std::variant<Material_SolidColor, Material_Lambert, Material_LambertPhong, Material_CookTorrence>;
+
+	/**
+	 * \brief Dispatches on the stored type with a jump table, every Shade body is visible here so none of them needs a virtual call
+	 */
+	inline ColorRGB Shade(const Material& material, const HitRecord& hitRecord, const Vector3& l, const Vector3& v)
+	{
+		return std::visit([&](const auto& typedMaterial) { return typedMaterial.Shade(hitRecord, l, v); }, material);
+	}
 }
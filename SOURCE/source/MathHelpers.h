@@ -12,18 +12,18 @@ namespace dae
 	constexpr auto TO_DEGREES{ 180.0f / PI };
 	constexpr auto TO_RADIANS{ PI / 180.0f };
 
-	inline float Square(float a)
+	constexpr float Square(float a)
 	{
 		return a * a;
 	}
 
-	inline float Lerpf(float a, float b, float factor)
+	constexpr float Lerpf(float a, float b, float factor)
 	{
 		return ((1 - factor) * a) + (factor * b);
 	}
 
 	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
-		return abs(a - b) < epsilon;
+		return std::abs(a - b) < epsilon;
 	}
 }
\ No newline at end of file
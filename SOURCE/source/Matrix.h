@@ -1,8 +1,12 @@
 #pragma once
+#include <cassert>
+#include <cmath>
 #include "Vector3.h"
 #include "Vector4.h"
+#include "SIMD.h"
 
 namespace dae {
+	// Header only, transforms and products work on whole rows with Float4 (SSE or NEON) where available
 	struct Matrix
 	{
 		Matrix() = default;
@@ -10,42 +14,228 @@ namespace dae {
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
 		Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t)
+		{
+			data[0] = xAxis;
+			data[1] = yAxis;
+			data[2] = zAxis;
+			data[3] = t;
+		}
+
+		Matrix(const Matrix& m) = default;
+		Matrix& operator=(const Matrix& m) = default;
+
+		Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		Vector3 TransformVector(float x, float y, float z) const
+		{
+			return Vector4::FromFloat4(Row(0) * Float4::Broadcast(x) + Row(1) * Float4::Broadcast(y) + Row(2) * Float4::Broadcast(z));
+		}
+
+		Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		Vector3 TransformPoint(float x, float y, float z) const
+		{
+			return Vector4::FromFloat4(Row(0) * Float4::Broadcast(x) + Row(1) * Float4::Broadcast(y) + Row(2) * Float4::Broadcast(z) + Row(3));
+		}
+
+		const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		const Matrix& Inverse()
+		{
+			// Affine inverse, the last column is assumed to be (0, 0, 0, 1) like for every matrix this class creates
+			const Vector3 xAxis{ data[0] };
+			const Vector3 yAxis{ data[1] };
+			const Vector3 zAxis{ data[2] };
+			const Vector3 translation{ data[3] };
+
+			const Vector3 yzCross{ Vector3::Cross(yAxis, zAxis) };
+			const Vector3 zxCross{ Vector3::Cross(zAxis, xAxis) };
+			const Vector3 xyCross{ Vector3::Cross(xAxis, yAxis) };
+			const float inverseDeterminant{ 1.0f / Vector3::Dot(xAxis, yzCross) };
+
+			data[0] = Vector4{ yzCross.x * inverseDeterminant, zxCross.x * inverseDeterminant, xyCross.x * inverseDeterminant, 0.0f };
+			data[1] = Vector4{ yzCross.y * inverseDeterminant, zxCross.y * inverseDeterminant, xyCross.y * inverseDeterminant, 0.0f };
+			data[2] = Vector4{ yzCross.z * inverseDeterminant, zxCross.z * inverseDeterminant, xyCross.z * inverseDeterminant, 0.0f };
+			data[3] = Vector4{ -TransformVector(translation), 1.0f };
+
+			return *this;
+		}
+
+		Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static Matrix CreateTranslation(float x, float y, float z)
+		{
+			return CreateTranslation(Vector3{ x, y, z });
+		}
+
+		static Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			float cosine{ cosf(pitch) };
+			float sine{ sinf(pitch)};
+
+			return Matrix{
+				Vector4{1.0f, 0.0f, 0.0f, 0.0f},
+				Vector4{0.0f, cosine, sine, 0.0f},
+				Vector4{0.0f, -sine, cosine, 0.0f,},
+				Vector4{0.0f, 0.0f, 0.0f, 1.0f}
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			float cosine{ cosf(yaw) };
+			float sine{ sinf(yaw) };
+
+			return Matrix{
+				Vector4{cosine, 0.0f, -sine, 0.0f},
+				Vector4{0.0f, 1.0f, 0.0f, 0.0f},
+				Vector4{sine, 0.0f, cosine, 0.0f,},
+				Vector4{0.0f, 0.0f, 0.0f, 1.0f}
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			float cosine{ cosf(roll) };
+			float sine{ sinf(roll) };
+
+			return Matrix{
+				Vector4{cosine, sine, 0.0f, 0.0f},
+				Vector4{-sine, cosine, 0.0f, 0.0f},
+				Vector4{0.0f, 0.0f, 1.0f, 0.0f,},
+				Vector4{0.0f, 0.0f, 0.0f, 1.0f}
+			};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation(Vector3{ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return CreateRotationX(r.x) * CreateRotationY(r.y) * CreateRotationZ(r.z);
+		}
+
+		static Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return Matrix{
+				Vector4{sx, 0.0f, 0.0f, 0.0f},
+				Vector4{0.0f, sy, 0.0f, 0.0f},
+				Vector4{0.0f, 0.0f, sz, 0.0f,},
+				Vector4{0.0f, 0.0f, 0.0f, 1.0f}
+			};
+		}
+
+		static Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s.x, s.y, s.z);
+		}
+
+		static Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static Matrix Inverse(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Inverse();
+
+			return out;
+		}
+
+		Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		Matrix operator*(const Matrix& m) const
+		{
+			// Row r of the product is the rows of m weighted by the elements of row r, summed in the same order as a dot product per element
+			Matrix result{};
+
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				const Vector4& row{ data[r] };
+				result.data[r] = Vector4::FromFloat4(m.Row(0) * Float4::Broadcast(row.x) + m.Row(1) * Float4::Broadcast(row.y)
+					+ m.Row(2) * Float4::Broadcast(row.z) + m.Row(3) * Float4::Broadcast(row.w));
+			}
+
+			return result;
+		}
+
+		const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
 
 	private:
 
@@ -62,5 +252,10 @@ namespace dae {
 		// v1x v1y v1z v1w
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
+
+		Float4 Row(int index) const
+		{
+			return data[index].ToFloat4();
+		}
 	};
 }
\ No newline at end of file
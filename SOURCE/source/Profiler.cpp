@@ -0,0 +1,167 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr uint32_t PixelStageCount{ uint32_t(Profiler::PixelStage::Count) };
+		const char* const PixelStageNames[PixelStageCount]{ "Camera ray", "Closest hit", "Shadow rays", "Material::Shade", "Pixel packing" };
+
+		struct Event
+		{
+			const char* name;
+			uint64_t start;
+			uint64_t duration;
+			uint32_t calls;
+		};
+
+		// Only ever touched by its own thread while recording, so zones never take a lock
+		struct ThreadBuffer
+		{
+			uint32_t threadId;
+			std::vector<Event> events;
+			uint64_t stageTimes[PixelStageCount];
+			uint32_t stageCalls[PixelStageCount];
+		};
+
+		std::mutex g_BuffersMutex{};
+		std::vector<std::unique_ptr<ThreadBuffer>> g_Buffers{};
+		std::atomic<bool> g_IsCapturing{ false };
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			thread_local ThreadBuffer* pBuffer{ nullptr };
+
+			if (!pBuffer)
+			{
+				const std::lock_guard<std::mutex> lock{ g_BuffersMutex };
+				g_Buffers.emplace_back(std::make_unique<ThreadBuffer>());
+				pBuffer = g_Buffers.back().get();
+				pBuffer->threadId = uint32_t(g_Buffers.size());
+				pBuffer->events.reserve(4096);
+			}
+
+			return *pBuffer;
+		}
+	}
+
+	void Profiler::BeginCapture()
+	{
+		g_IsCapturing = true;
+	}
+
+	void Profiler::EndCapture()
+	{
+		g_IsCapturing = false;
+	}
+
+	bool Profiler::IsCapturing()
+	{
+		return g_IsCapturing.load(std::memory_order_relaxed);
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& filename)
+	{
+		const std::lock_guard<std::mutex> lock{ g_BuffersMutex };
+
+		std::ofstream file(filename);
+		if (!file)
+			return false;
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool isFirstEvent{ true };
+
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : g_Buffers)
+		{
+			file << (isFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pBuffer->threadId
+				<< ",\"args\":{\"name\":\"Thread " << pBuffer->threadId << "\"}}";
+			isFirstEvent = false;
+
+			for (const Event& event : pBuffer->events)
+			{
+				// Chrome trace timestamps are in microseconds
+				file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pBuffer->threadId
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+				if (event.calls > 1) file << ",\"args\":{\"calls\":" << event.calls << "}";
+				file << "}";
+			}
+
+			pBuffer->events.clear();
+		}
+
+		file << "\n]}\n";
+		return bool(file);
+	}
+
+	uint64_t Profiler::GetTimeNanoseconds()
+	{
+		static const auto epoch{ std::chrono::steady_clock::now() };
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+	}
+
+	Profiler::Zone::Zone(const char* name) :
+		m_Name{ name },
+		m_Start{ IsCapturing() ? GetTimeNanoseconds() : 0 }
+	{
+	}
+
+	Profiler::Zone::~Zone()
+	{
+		if (m_Start == 0) return;
+
+		GetThreadBuffer().events.emplace_back(Event{ m_Name, m_Start, GetTimeNanoseconds() - m_Start, 1 });
+	}
+
+	Profiler::TileZone::TileZone() :
+		m_Start{ 0 }
+	{
+		if (!IsCapturing()) return;
+
+		ThreadBuffer& buffer{ GetThreadBuffer() };
+		std::fill(std::begin(buffer.stageTimes), std::end(buffer.stageTimes), 0);
+		std::fill(std::begin(buffer.stageCalls), std::end(buffer.stageCalls), 0);
+		m_Start = GetTimeNanoseconds();
+	}
+
+	Profiler::TileZone::~TileZone()
+	{
+		if (m_Start == 0) return;
+
+		const uint64_t end{ GetTimeNanoseconds() };
+		ThreadBuffer& buffer{ GetThreadBuffer() };
+		uint64_t stageStart{ m_Start };
+
+		for (uint32_t stage{}; stage < PixelStageCount; ++stage)
+		{
+			if (buffer.stageCalls[stage] == 0) continue;
+
+			buffer.events.emplace_back(Event{ PixelStageNames[stage], stageStart, buffer.stageTimes[stage], buffer.stageCalls[stage] });
+			stageStart += buffer.stageTimes[stage];
+		}
+
+		buffer.events.emplace_back(Event{ "Tile", m_Start, end - m_Start, 1 });
+	}
+
+	Profiler::PixelZone::PixelZone(PixelStage stage) :
+		m_Stage{ stage },
+		m_Start{ IsCapturing() ? GetTimeNanoseconds() : 0 }
+	{
+	}
+
+	Profiler::PixelZone::~PixelZone()
+	{
+		if (m_Start == 0) return;
+
+		ThreadBuffer& buffer{ GetThreadBuffer() };
+		buffer.stageTimes[uint32_t(m_Stage)] += GetTimeNanoseconds() - m_Start;
+		++buffer.stageCalls[uint32_t(m_Stage)];
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+
+// Define for the whole build (CMake: -DRAYTRACER_PROFILING=ON) to record profiling zones, without it every zone compiles to nothing
+//#define RAYTRACER_PROFILING
+
+namespace dae
+{
+	namespace Profiler
+	{
+		// Stages that run once per pixel, too often for a trace event each, their time is summed per tile instead
+		enum class PixelStage : uint32_t
+		{
+			CameraRay,
+			ClosestHit,
+			ShadowRays,
+			Shading,
+			PixelPacking,
+			Count
+		};
+
+		void BeginCapture();
+		void EndCapture();
+		bool IsCapturing();
+
+		/**
+		 * \brief Writes every zone recorded since the last write as Chrome trace / Perfetto JSON and clears the buffers
+		 * Only call it while no zones are being recorded, so between frames
+		 */
+		bool WriteChromeTrace(const std::string& filename);
+
+		uint64_t GetTimeNanoseconds();
+
+		/**
+		 * \brief Records the time between its construction and destruction as one trace event on the current thread
+		 */
+		class Zone final
+		{
+		public:
+			explicit Zone(const char* name);
+			~Zone();
+
+			Zone(const Zone&) = delete;
+			Zone(Zone&&) noexcept = delete;
+			Zone& operator=(const Zone&) = delete;
+			Zone& operator=(Zone&&) noexcept = delete;
+
+		private:
+			const char* m_Name;
+			uint64_t m_Start;
+		};
+
+		/**
+		 * \brief Zone around a tile, the pixel stages measured inside it are drawn as consecutive children of the tile event
+		 * Their lengths are the exact totals per stage, their position inside the tile is not where they ran
+		 */
+		class TileZone final
+		{
+		public:
+			TileZone();
+			~TileZone();
+
+			TileZone(const TileZone&) = delete;
+			TileZone(TileZone&&) noexcept = delete;
+			TileZone& operator=(const TileZone&) = delete;
+			TileZone& operator=(TileZone&&) noexcept = delete;
+
+		private:
+			uint64_t m_Start;
+		};
+
+		/**
+		 * \brief Adds the time between its construction and destruction to the total of its stage for the current tile
+		 */
+		class PixelZone final
+		{
+		public:
+			explicit PixelZone(PixelStage stage);
+			~PixelZone();
+
+			PixelZone(const PixelZone&) = delete;
+			PixelZone(PixelZone&&) noexcept = delete;
+			PixelZone& operator=(const PixelZone&) = delete;
+			PixelZone& operator=(PixelZone&&) noexcept = delete;
+
+		private:
+			PixelStage m_Stage;
+			uint64_t m_Start;
+		};
+	}
+}
+
+#if defined(RAYTRACER_PROFILING)
+	#define PROFILE_CONCAT_INNER(a, b) a##b
+	#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+	#define PROFILE_ZONE(name) const ::dae::Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__){ name }
+	#define PROFILE_TILE_ZONE() const ::dae::Profiler::TileZone PROFILE_CONCAT(profileTileZone, __LINE__){}
+	#define PROFILE_PIXEL_ZONE(stage) const ::dae::Profiler::PixelZone PROFILE_CONCAT(profilePixelZone, __LINE__){ ::dae::Profiler::PixelStage::stage }
+#else
+	#define PROFILE_ZONE(name)
+	#define PROFILE_TILE_ZONE()
+	#define PROFILE_PIXEL_ZONE(stage)
+#endif
@@ -0,0 +1,85 @@
+#include "RenderStats.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr uint32_t CounterCount{ uint32_t(Stats::Counter::Count) };
+		const char* const CounterNames[CounterCount]{ "primary_rays", "primary_hits", "shadow_rays", "shadow_hits", "sphere_tests", "sphere_hits",
+			"plane_tests", "plane_hits", "triangle_tests", "triangle_hits", "aabb_tests", "aabb_hits" };
+
+		std::mutex g_ThreadCountersMutex{};
+		std::vector<std::unique_ptr<Stats::ThreadCounters>> g_ThreadCounters{};
+
+		double Ratio(uint64_t part, uint64_t total)
+		{
+			return (total > 0) ? 100.0 * double(part) / double(total) : 0.0;
+		}
+	}
+
+	Stats::FrameStats& Stats::FrameStats::operator+=(const FrameStats& other)
+	{
+		for (uint32_t counter{}; counter < CounterCount; ++counter)
+		{
+			counters[counter] += other.counters[counter];
+		}
+
+		return *this;
+	}
+
+	Stats::ThreadCounters* Stats::RegisterThread()
+	{
+		const std::lock_guard<std::mutex> lock{ g_ThreadCountersMutex };
+
+		// Kept after the thread exits, so counts of a resized thread pool still reach the next CollectFrame
+		g_ThreadCounters.emplace_back(std::make_unique<ThreadCounters>());
+		for (std::atomic<uint64_t>& value : g_ThreadCounters.back()->values) value = 0;
+
+		return g_ThreadCounters.back().get();
+	}
+
+	Stats::FrameStats Stats::CollectFrame()
+	{
+		const std::lock_guard<std::mutex> lock{ g_ThreadCountersMutex };
+		FrameStats stats{};
+
+		for (const std::unique_ptr<ThreadCounters>& pCounters : g_ThreadCounters)
+		{
+			for (uint32_t counter{}; counter < CounterCount; ++counter)
+			{
+				stats.counters[counter] += pCounters->values[counter].exchange(0, std::memory_order_relaxed);
+			}
+		}
+
+		return stats;
+	}
+
+	void Stats::Print(std::ostream& stream, const FrameStats& stats, uint32_t frameCount)
+	{
+		const double frames{ double(std::max(1u, frameCount)) };
+		const auto perFrame{ [&](Counter counter) { return double(stats.Get(counter)) / frames / 1'000'000.0; } };
+
+		stream << "  Rays per frame: " << perFrame(Counter::PrimaryRays) << "M primary (" << Ratio(stats.Get(Counter::PrimaryHits), stats.Get(Counter::PrimaryRays))
+			<< "% hit), " << perFrame(Counter::ShadowRays) << "M shadow (" << Ratio(stats.Get(Counter::ShadowHits), stats.Get(Counter::ShadowRays)) << "% occluded)\n";
+		stream << "  Tests per frame: " << perFrame(Counter::SphereTests) << "M sphere (" << Ratio(stats.Get(Counter::SphereHits), stats.Get(Counter::SphereTests)) << "% hit), "
+			<< perFrame(Counter::PlaneTests) << "M plane (" << Ratio(stats.Get(Counter::PlaneHits), stats.Get(Counter::PlaneTests)) << "% hit), "
+			<< perFrame(Counter::TriangleTests) << "M triangle (" << Ratio(stats.Get(Counter::TriangleHits), stats.Get(Counter::TriangleTests)) << "% hit), "
+			<< perFrame(Counter::AABBTests) << "M AABB (" << Ratio(stats.Get(Counter::AABBHits), stats.Get(Counter::AABBTests)) << "% hit)" << std::endl;
+	}
+
+	void Stats::WriteJSON(std::ostream& stream, const FrameStats& stats)
+	{
+		stream << "{ ";
+
+		for (uint32_t counter{}; counter < CounterCount; ++counter)
+		{
+			stream << (counter > 0 ? ", " : "") << "\"" << CounterNames[counter] << "\": " << stats.counters[counter];
+		}
+
+		stream << " }";
+	}
+}
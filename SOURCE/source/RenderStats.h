@@ -0,0 +1,83 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Define for the whole build (CMake: -DRAYTRACER_STATS=ON) to count rays and intersection tests, without it every counter compiles to nothing
+//#define RAYTRACER_STATS
+
+namespace dae
+{
+	namespace Stats
+	{
+		enum class Counter : uint32_t
+		{
+			PrimaryRays,		// Scene::GetClosestHit queries, only camera rays use it
+			PrimaryHits,
+			ShadowRays,			// Scene::IsOccluded queries
+			ShadowHits,			// Shadow rays that were blocked
+			SphereTests,
+			SphereHits,
+			PlaneTests,
+			PlaneHits,
+			TriangleTests,		// Real triangles only, the padding lanes of triangle blocks are not counted
+			TriangleHits,
+			AABBTests,			// Boxes of binary nodes, and every used child box of a wide node
+			AABBHits,
+			Count
+		};
+
+		/**
+		 * \brief Counter totals merged from every thread
+		 */
+		struct FrameStats
+		{
+			uint64_t Get(Counter counter) const { return counters[uint32_t(counter)]; }
+			FrameStats& operator+=(const FrameStats& other);
+
+			uint64_t counters[uint32_t(Counter::Count)]{};
+		};
+
+		// Written by its own thread only, atomics so that CollectFrame can read them without a data race
+		struct ThreadCounters
+		{
+			std::atomic<uint64_t> values[uint32_t(Counter::Count)];
+		};
+
+		ThreadCounters* RegisterThread();
+
+		inline void Add(Counter counter, uint64_t amount)
+		{
+			thread_local ThreadCounters* pCounters{ RegisterThread() };
+
+			// Single writer, so a plain load and store is enough and no locked add is needed
+			std::atomic<uint64_t>& value{ pCounters->values[uint32_t(counter)] };
+			value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		/**
+		 * \brief Sums the counters of every thread and resets them, call it between frames
+		 */
+		FrameStats CollectFrame();
+
+		/**
+		 * \brief Prints the counters averaged over frameCount frames, with the hit ratio of every test
+		 */
+		void Print(std::ostream& stream, const FrameStats& stats, uint32_t frameCount = 1);
+
+		/**
+		 * \brief Writes the counter totals as a JSON object
+		 */
+		void WriteJSON(std::ostream& stream, const FrameStats& stats);
+	}
+}
+
+#if defined(RAYTRACER_STATS)
+	#define STATS_ADD(counter, amount) ::dae::Stats::Add(::dae::Stats::Counter::counter, uint64_t(amount))
+#else
+	#define STATS_ADD(counter, amount) ((void)0)	// Still a statement, so STATS_INCREMENT can be the body of an if
+#endif
+
+#define STATS_INCREMENT(counter) STATS_ADD(counter, 1)
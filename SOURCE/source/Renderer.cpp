@@ -1,21 +1,231 @@
-#include <SDL.h>
-#include <SDL_surface.h>
-#include <execution>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
 #include "Renderer.h"
 #include "Utils.h"
+#include "Profiler.h"
 
 #define PARALLEL_EXECUTION
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window* pWindow) :
-	m_pWindow{ pWindow },
-	m_pBuffer{ SDL_GetWindowSurface(pWindow) },
-	m_pBufferPixels{ static_cast<uint32_t*>(m_pBuffer->pixels) },
-	m_Width{ 0 },
-	m_Height{ 0 },
+namespace
+{
+	// Cheap enough to read around every pixel, cycles on x86 and nanoseconds elsewhere, only ever compared within one frame
+	inline uint64_t ReadCostCounter()
+	{
+	#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+	#else
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	#endif
+	}
+
+	// Blue over cyan, green and yellow to red, cost is normalized to [0, 1]
+	uint32_t HeatmapColor(float cost)
+	{
+		const ColorRGB stops[]{ { 0.0f, 0.0f, 0.5f }, { 0.0f, 0.8f, 1.0f }, { 0.1f, 0.9f, 0.1f }, { 1.0f, 0.9f, 0.0f }, { 1.0f, 0.0f, 0.0f } };
+		constexpr uint32_t lastStop{ uint32_t(std::size(stops)) - 1 };
+
+		const float position{ std::clamp(cost, 0.0f, 1.0f) * lastStop };
+		const uint32_t stop{ std::min(uint32_t(position), lastStop - 1) };
+		const float blend{ position - float(stop) };
+		const ColorRGB color{ stops[stop] * (1.0f - blend) + stops[stop + 1] * blend };
+
+		return Framebuffer::PackRGB(static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255));
+	}
+
+	// Two neighbouring source pixels and the weight of the second one out of 256
+	struct FilterTap
+	{
+		uint32_t first;
+		uint32_t second;
+		uint32_t weight;
+	};
+
+	// Pixel centers of the source and the output line up, the outer half pixel clamps to the edge
+	FilterTap GetFilterTap(uint32_t outputIndex, uint32_t outputSize, uint32_t sourceSize)
+	{
+		const float position{ std::max(0.0f, (float(outputIndex) + 0.5f) * float(sourceSize) / float(outputSize) - 0.5f) };
+		const uint32_t first{ std::min(uint32_t(position), sourceSize - 1) };
+
+		return FilterTap{ first, std::min(first + 1, sourceSize - 1), uint32_t((position - float(first)) * 256.0f) };
+	}
+
+	// Red and blue share one multiply, each keeps 16 bits of room in its half of the word
+	inline uint32_t BlendPixels(uint32_t first, uint32_t second, uint32_t weight)
+	{
+		const uint32_t redBlue{ (((first & 0x00FF00FFu) * (256 - weight) + (second & 0x00FF00FFu) * weight) >> 8) & 0x00FF00FFu };
+		const uint32_t green{ (((first & 0x0000FF00u) * (256 - weight) + (second & 0x0000FF00u) * weight) >> 8) & 0x0000FF00u };
+
+		return redBlue | green;
+	}
+
+	// Shadow ray from a hit towards a light, lightRayDirection is left unnormalized for the cosine law
+	Ray GetLightRay(const Light& light, const Vector3& origin, Vector3& lightRayDirection)
+	{
+		lightRayDirection = LightUtils::GetDirectionToLight(light, origin);
+		const float lightRayDirectionMagnitude{ lightRayDirection.Magnitude() };
+
+		Ray lightRay{ origin, lightRayDirection / lightRayDirectionMagnitude };
+		lightRay.min = 0.01f;
+		lightRay.max = lightRayDirectionMagnitude;
+
+		return lightRay;
+	}
+
+	// Spreads the low 10 bits of value so two zero bits follow every bit, three of them interleave into a Morton code
+	uint32_t SpreadBits3(uint32_t value)
+	{
+		value &= 0x3ff;
+		value = (value | (value << 16)) & 0x030000ff;
+		value = (value | (value << 8)) & 0x0300f00f;
+		value = (value | (value << 4)) & 0x030c30c3;
+		value = (value | (value << 2)) & 0x09249249;
+
+		return value;
+	}
+
+	// Points with Dot(normal, point) + offset * w >= 0, where w is 1 for a point and 0 for a direction, the point at infinity along it
+	struct HalfSpace
+	{
+		Vector3 normal;
+		float offset;
+
+		float Distance(const Vector4& point) const { return normal.x * point.x + normal.y * point.y + normal.z * point.z + offset * point.w; }
+	};
+
+	// Pixel area a moved object or its shadow can cover, unbounded sides reach past the screen edge
+	struct ScreenBounds
+	{
+		float minX;
+		float minY;
+		float maxX;
+		float maxY;
+	};
+
+	HalfSpace MakeHalfSpace(const Vector3& normal, const Vector3& pointOnPlane)
+	{
+		return HalfSpace{ normal, -Vector3::Dot(normal, pointOnPlane) };
+	}
+
+	// Flips the half space so inside lies in it, false when inside is on its plane
+	bool OrientHalfSpace(HalfSpace& halfSpace, const Vector4& inside)
+	{
+		const float distance{ halfSpace.Distance(inside) };
+		if (distance == 0.0f) return false;
+
+		if (distance < 0.0f) halfSpace = HalfSpace{ -halfSpace.normal, -halfSpace.offset };
+		return true;
+	}
+
+	// Sutherland-Hodgman in homogeneous coordinates, so polygons with corners at infinity clip like any other
+	void ClipPolygon(std::vector<Vector4>& polygon, std::vector<Vector4>& scratch, const HalfSpace& halfSpace)
+	{
+		scratch.clear();
+
+		for (size_t index{}; index < polygon.size(); ++index)
+		{
+			const Vector4& current{ polygon[index] };
+			const Vector4& next{ polygon[(index + 1) % polygon.size()] };
+			const float currentDistance{ halfSpace.Distance(current) };
+			const float nextDistance{ halfSpace.Distance(next) };
+
+			if (currentDistance >= 0.0f) scratch.emplace_back(current);
+
+			// Both weights are positive, so w stays positive or 0 and the crossing lies between the two corners even when one is at infinity
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				const float weightSum{ std::abs(currentDistance) + std::abs(nextDistance) };
+				scratch.emplace_back(current * (std::abs(nextDistance) / weightSum) + next * (std::abs(currentDistance) / weightSum));
+			}
+		}
+
+		polygon.swap(scratch);
+	}
+
+	// Calls visit for every corner of the part of the plane of halfSpaces[face] inside all other half spaces, corners at infinity have w = 0
+	template<typename Visitor>
+	void VisitFaceCorners(const std::vector<HalfSpace>& halfSpaces, size_t face, const Visitor& visit)
+	{
+		const Vector3& normal{ halfSpaces[face].normal };
+		const Vector3 planePoint{ normal * (-halfSpaces[face].offset / normal.SqrMagnitude()) };
+		const Vector3 tangent{ Vector3::Cross(normal, std::abs(normal.x) < std::abs(normal.z) ? Vector3::UnitX : Vector3::UnitZ) };
+		const Vector3 bitangent{ Vector3::Cross(normal, tangent) };
+		const Vector4 directions[4]{ { tangent, 0.0f }, { bitangent, 0.0f }, { -tangent, 0.0f }, { -bitangent, 0.0f } };
+		std::vector<Vector4> polygon{};
+		std::vector<Vector4> scratch{};
+
+		// The plane as four quadrants, each spanned by the plane point and two directions along the plane
+		for (uint32_t quadrant{}; quadrant < 4; ++quadrant)
+		{
+			polygon.assign({ Vector4{ planePoint, 1.0f }, directions[quadrant], directions[(quadrant + 1) % 4] });
+
+			for (size_t other{}; other < halfSpaces.size() && !polygon.empty(); ++other)
+			{
+				if (other != face) ClipPolygon(polygon, scratch, halfSpaces[other]);
+			}
+
+			for (const Vector4& corner : polygon) visit(corner);
+		}
+	}
+
+	// Calls visit for every corner of the convex region inside all half spaces
+	// Every corner lies on one of the planes, so clipping each whole plane by all other half spaces finds them all
+	template<typename Visitor>
+	void VisitRegionCorners(const std::vector<HalfSpace>& halfSpaces, const Visitor& visit)
+	{
+		for (size_t face{}; face < halfSpaces.size(); ++face) VisitFaceCorners(halfSpaces, face, visit);
+	}
+
+	// Stable LSD radix sort on the key member, 11 bits per pass
+	template<typename Item>
+	void RadixSortByKey(std::vector<Item>& items, std::vector<Item>& scratch, uint32_t keyBits)
+	{
+		constexpr uint32_t digitBits{ 11 };
+		constexpr uint32_t bucketCount{ 1u << digitBits };
+		scratch.resize(items.size());
+
+		for (uint32_t shift{}; shift < keyBits; shift += digitBits)
+		{
+			uint32_t offsets[bucketCount]{};
+			for (const Item& item : items) ++offsets[(item.key >> shift) & (bucketCount - 1)];
+
+			uint32_t offset{};
+			for (uint32_t& bucket : offsets)
+			{
+				const uint32_t count{ bucket };
+				bucket = offset;
+				offset += count;
+			}
+
+			for (const Item& item : items) scratch[offsets[(item.key >> shift) & (bucketCount - 1)]++] = item;
+			items.swap(scratch);
+		}
+	}
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height) :
+	m_Framebuffer{ width, height },
+	m_OutputFramebuffer{ width, height },
+	m_Width{ int(width) },
+	m_Height{ int(height) },
 	m_CurrentLightingMode{ LightingMode::Combined },
 	m_ShadowsEnabled{ true },
+	m_CostHeatmapEnabled{ false },
+	m_SortedShadingEnabled{ false },
+	m_PacketTracingEnabled{ true },
+	m_WavefrontEnabled{ false },
+	m_DirtyTilesEnabled{ true },
 	m_pScene{ nullptr },
 	m_Camera{ nullptr },
 	m_Materials{ nullptr },
@@ -23,13 +233,27 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	m_NrOfPixels{ uint32_t(0) },
 	m_FieldOfVieuw{ 0.0f },
 	m_AscpectRatio{ 0.0f },
-	m_Pixelindices{}
+	m_TileSize{ 16 },
+	m_Tiles{},
+	m_NextTile{ 0 },
+	m_DirtyTiles{},
+	m_RenderedTileFraction{ 1.0f },
+	m_RayCount{ 0 },
+	m_PixelCosts{},
+	m_CameraSpaceDirections{},
+	m_CameraRayDirections{},
+	m_DirectionTableFovAngle{ 0.0f },
+	m_DirectionTableAxes{},
+	m_WavefrontHits{},
+	m_ShadowRayStream{},
+	m_ShadowRayScratch{},
+	m_ShadowOcclusion{},
+	m_ThreadPool{},
+	m_RenderedFrame{}
 {
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 	m_NrOfPixels = uint32_t(m_Width * m_Height);
 	m_AscpectRatio = float(m_Width) / float(m_Height);
-	m_Pixelindices.reserve(m_NrOfPixels);
-	for (uint32_t index{ uint32_t(0) }; index < m_NrOfPixels; index++) m_Pixelindices.emplace_back(index);
+	CreateTiles();
 }
 
 void Renderer::SetScene(Scene* pScene)
@@ -38,33 +262,54 @@ void Renderer::SetScene(Scene* pScene)
 	m_Camera = &pScene->GetCamera();
 	m_Materials = &pScene->GetMaterials();
 	m_Lights = &pScene->GetLights();
-	m_FieldOfVieuw = tanf((dae::TO_RADIANS * m_Camera->fovAngle) / 2);
 }
 
 void Renderer::Render() const
 {
+	PROFILE_ZONE("Renderer::Render");
 	m_Camera->CalculateCameraToWorld();
+	UpdateCameraRayDirections();
+	const bool dirtyTilesOnly{ CollectDirtyTiles() };
+	m_RenderedFrame = GetFrameState();
+	m_RayCount = 0;
 
-	#if defined(PARALLEL_EXECUTION)
-		std::for_each(std::execution::par, m_Pixelindices.begin(), m_Pixelindices.end(),
-			[&](int i)
-			{
-				RenderPixel(i);
-			}
-		);
-	#else
-		for (uint32_t pixelIndex{}; pixelIndex < m_NrOfPixels; pixelIndex++)
-		{
-			RenderPixel(pixelIndex);
-		}
-	#endif
+	// Every other tile still holds the right pixels from the last frame
+	if (dirtyTilesOnly)
+	{
+		m_RenderedTileFraction = float(m_DirtyTiles.size()) / float(m_Tiles.size());
+		DispatchTiles(SelectTileRenderer(), m_DirtyTiles);
+	}
+	// The heatmap times every pixel on its own, which needs the per pixel tiles
+	else if (m_WavefrontEnabled && !m_CostHeatmapEnabled)
+	{
+		m_RenderedTileFraction = 1.0f;
+		(this->*SelectWavefrontRenderer())();
+	}
+	else
+	{
+		m_RenderedTileFraction = 1.0f;
+		DispatchTiles(SelectTileRenderer(), m_Tiles);
+
+		if (m_CostHeatmapEnabled) DrawCostHeatmap();
+	}
+
+	if (IsUpscaling()) UpscaleFramebuffer();
+}
 
-	SDL_UpdateWindowSurface(m_pWindow);
+bool Renderer::IsFrameOutdated() const
+{
+	return m_pScene == nullptr || GetFrameState() != m_RenderedFrame;
+}
+
+Renderer::FrameState Renderer::GetFrameState() const
+{
+	return FrameState{ m_pScene, m_pScene->GetVersion(), m_Camera->version, m_CurrentLightingMode, m_ShadowsEnabled, m_CostHeatmapEnabled, m_Width, m_Height };
 }
 
 bool Renderer::SaveBufferToImage() const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	// Returns true on failure, like the SDL_SaveBMP call it replaced
+	return !GetFramebuffer().SaveBMP("RayTracing_Buffer.bmp");
 }
 
 void Renderer::CycleLigtingMode()
@@ -93,74 +338,943 @@ void Renderer::ToggleShadows()
 	m_ShadowsEnabled = !m_ShadowsEnabled;
 }
 
-float Renderer::LambertsCosineLaw(const dae::Vector3& normalSurface, const dae::Vector3& incomingLight, float incomingLightMagnitude) const
+void Renderer::ToggleSortedShading()
 {
-	return (Vector3::Dot(normalSurface, incomingLight) / incomingLightMagnitude);
+	m_SortedShadingEnabled = !m_SortedShadingEnabled;
+	std::cout << "Material sorted shading: " << (m_SortedShadingEnabled ? "on" : "off") << std::endl;
 }
 
-void Renderer::RenderPixel(uint32_t pixelIndex) const
+void Renderer::TogglePacketTracing()
 {
-	const uint32_t px{ pixelIndex % m_Width };
-	const uint32_t py{ pixelIndex / m_Width };
-	float rx{ px + 0.5f }, ry{ py + 0.5f };
-	float worldX{ (2 * (rx / float(m_Width)) - 1) * m_AscpectRatio * m_FieldOfVieuw };
-	float worldY{ (1 - (2 * (ry / float(m_Height)))) * m_FieldOfVieuw };
+	m_PacketTracingEnabled = !m_PacketTracingEnabled;
+	std::cout << "Packet tracing: " << (m_PacketTracingEnabled ? "on" : "off") << std::endl;
+}
 
-	Vector3 cameraRayDirection{ m_Camera->cameraToWorld.TransformVector(Vector3{ worldX, worldY, 1.0f }.Normalized()) };
-	Ray cameraRay{ m_Camera->origin, cameraRayDirection };
+void Renderer::ToggleWavefront()
+{
+	m_WavefrontEnabled = !m_WavefrontEnabled;
+	std::cout << "Wavefront rendering: " << (m_WavefrontEnabled ? "on" : "off") << std::endl;
+}
 
-	ColorRGB color{ colors::Black };
-	HitRecord closestHit{};
+void Renderer::ToggleDirtyTiles()
+{
+	m_DirtyTilesEnabled = !m_DirtyTilesEnabled;
+	std::cout << "Redraw dirty tiles only: " << (m_DirtyTilesEnabled ? "on" : "off") << std::endl;
+}
+
+void Renderer::ToggleCostHeatmap()
+{
+	m_CostHeatmapEnabled = !m_CostHeatmapEnabled;
+	m_PixelCosts.assign(m_CostHeatmapEnabled ? m_NrOfPixels : 0, 0);
 
-	m_pScene->GetClosestHit(cameraRay, closestHit);
+	std::cout << "Cost heatmap: " << (m_CostHeatmapEnabled ? "on" : "off") << std::endl;
+}
 
-	if (closestHit.didHit)
+bool Renderer::SaveCostBuffer(const std::string& filename) const
+{
+	if (m_PixelCosts.empty())
+		return false;
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Width and height followed by one cost per pixel, rows top to bottom, all as little endian uint32
+	const uint32_t header[]{ uint32_t(m_Width), uint32_t(m_Height) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_PixelCosts.data()), std::streamsize(m_PixelCosts.size() * sizeof(uint32_t)));
+
+	return bool(file);
+}
+
+void Renderer::SetResolutionScale(float resolutionScale)
+{
+	// The aspect ratio stays the one of the output, so a rounded size only stretches the pixels a little and never the image
+	const float scale{ std::clamp(resolutionScale, 0.0f, 1.0f) };
+	const int width{ std::max(1, int(std::lround(float(m_OutputFramebuffer.width) * scale))) };
+	const int height{ std::max(1, int(std::lround(float(m_OutputFramebuffer.height) * scale))) };
+	if (width == m_Width && height == m_Height)
+		return;
+
+	m_Width = width;
+	m_Height = height;
+	m_NrOfPixels = uint32_t(m_Width * m_Height);
+	m_Framebuffer.width = uint32_t(m_Width);
+	m_Framebuffer.height = uint32_t(m_Height);
+	m_Framebuffer.pixels.assign(m_NrOfPixels, 0);
+	m_PixelCosts.assign(m_CostHeatmapEnabled ? m_NrOfPixels : 0, 0);
+	m_CameraSpaceDirections.clear();
+	CreateTiles();
+}
+
+void Renderer::SetTileSize(uint32_t tileSize)
+{
+	m_TileSize = std::max(1u, tileSize);
+	CreateTiles();
+}
+
+void Renderer::SetThreadCount(uint32_t threadCount)
+{
+	m_ThreadPool.Resize(std::max(1u, threadCount), m_ThreadPool.ArePinned());
+}
+
+void Renderer::SetThreadPinning(bool pinThreads)
+{
+	m_ThreadPool.Resize(m_ThreadPool.GetThreadCount(), pinThreads);
+}
+
+void Renderer::CreateTiles()
+{
+	const uint32_t tilesX{ (uint32_t(m_Width) + m_TileSize - 1) / m_TileSize };
+	const uint32_t tilesY{ (uint32_t(m_Height) + m_TileSize - 1) / m_TileSize };
+
+	m_Tiles.clear();
+	m_Tiles.reserve(size_t(tilesX) * tilesY);
+
+	for (uint32_t tileY{}; tileY < tilesY; ++tileY)
 	{
-		for (const Light& light : *m_Lights)
+		for (uint32_t tileX{}; tileX < tilesX; ++tileX)
 		{
-			const Vector3 lightRayOrigin{ closestHit.origin };
-			const Vector3 lightRayDirection{ LightUtils::GetDirectionToLight(light, closestHit.origin) };
-			const float lightRayDirectionMagnitude{ lightRayDirection.Magnitude() };
-			Ray lightRay{ lightRayOrigin, lightRayDirection / lightRayDirectionMagnitude };
-			lightRay.min = 0.01f;
-			lightRay.max = lightRayDirectionMagnitude;
+			const uint32_t x{ tileX * m_TileSize };
+			const uint32_t y{ tileY * m_TileSize };
+
+			m_Tiles.emplace_back(Tile{ x, y, std::min(m_TileSize, uint32_t(m_Width) - x), std::min(m_TileSize, uint32_t(m_Height) - y) });
+		}
+	}
 
-			const float observedArea{ LambertsCosineLaw(closestHit.normal, lightRayDirection, lightRayDirectionMagnitude) };
+	// Z-order, tiles that get picked up around the same time lie next to each other and touch the same part of the scene
+	const auto mortonCode{ [this](const Tile& tile)
+		{
+			const uint32_t tileX{ tile.x / m_TileSize };
+			const uint32_t tileY{ tile.y / m_TileSize };
+			uint32_t code{};
 
-			if (m_ShadowsEnabled && m_pScene->DoesHit(lightRay))
+			for (uint32_t bit{}; bit < 16; ++bit)
 			{
-				color *= 0.5f;
+				code |= ((tileX >> bit) & 1u) << (2 * bit);
+				code |= ((tileY >> bit) & 1u) << (2 * bit + 1);
 			}
-			else
+
+			return code;
+		}
+	};
+
+	std::sort(m_Tiles.begin(), m_Tiles.end(), [&](const Tile& a, const Tile& b) { return mortonCode(a) < mortonCode(b); });
+}
+
+Renderer::TileRenderer Renderer::SelectTileRenderer() const
+{
+	// Indexed by lighting mode and shadow flag, so the pixel loop itself never branches on either
+	static constexpr TileRenderer tileRenderers[][2]
+	{
+		{ &Renderer::RenderTile<LightingMode::ObservedArea, false>, &Renderer::RenderTile<LightingMode::ObservedArea, true> },
+		{ &Renderer::RenderTile<LightingMode::Radiance, false>, &Renderer::RenderTile<LightingMode::Radiance, true> },
+		{ &Renderer::RenderTile<LightingMode::BDRF, false>, &Renderer::RenderTile<LightingMode::BDRF, true> },
+		{ &Renderer::RenderTile<LightingMode::Combined, false>, &Renderer::RenderTile<LightingMode::Combined, true> }
+	};
+	static constexpr TileRenderer sortedTileRenderers[][2]
+	{
+		{ &Renderer::RenderTileSorted<LightingMode::ObservedArea, false>, &Renderer::RenderTileSorted<LightingMode::ObservedArea, true> },
+		{ &Renderer::RenderTileSorted<LightingMode::Radiance, false>, &Renderer::RenderTileSorted<LightingMode::Radiance, true> },
+		{ &Renderer::RenderTileSorted<LightingMode::BDRF, false>, &Renderer::RenderTileSorted<LightingMode::BDRF, true> },
+		{ &Renderer::RenderTileSorted<LightingMode::Combined, false>, &Renderer::RenderTileSorted<LightingMode::Combined, true> }
+	};
+	static constexpr TileRenderer packetTileRenderers[][2]
+	{
+		{ &Renderer::RenderTilePackets<LightingMode::ObservedArea, false>, &Renderer::RenderTilePackets<LightingMode::ObservedArea, true> },
+		{ &Renderer::RenderTilePackets<LightingMode::Radiance, false>, &Renderer::RenderTilePackets<LightingMode::Radiance, true> },
+		{ &Renderer::RenderTilePackets<LightingMode::BDRF, false>, &Renderer::RenderTilePackets<LightingMode::BDRF, true> },
+		{ &Renderer::RenderTilePackets<LightingMode::Combined, false>, &Renderer::RenderTilePackets<LightingMode::Combined, true> }
+	};
+
+	// The heatmap times every pixel on its own, which the two pass and packet tiles cannot do
+	if (m_CostHeatmapEnabled) return tileRenderers[int(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
+	if (m_SortedShadingEnabled) return sortedTileRenderers[int(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
+	if (m_PacketTracingEnabled) return packetTileRenderers[int(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
+	return tileRenderers[int(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
+}
+
+Renderer::FrameRenderer Renderer::SelectWavefrontRenderer() const
+{
+	static constexpr FrameRenderer wavefrontRenderers[][2]
+	{
+		{ &Renderer::RenderWavefront<LightingMode::ObservedArea, false>, &Renderer::RenderWavefront<LightingMode::ObservedArea, true> },
+		{ &Renderer::RenderWavefront<LightingMode::Radiance, false>, &Renderer::RenderWavefront<LightingMode::Radiance, true> },
+		{ &Renderer::RenderWavefront<LightingMode::BDRF, false>, &Renderer::RenderWavefront<LightingMode::BDRF, true> },
+		{ &Renderer::RenderWavefront<LightingMode::Combined, false>, &Renderer::RenderWavefront<LightingMode::Combined, true> }
+	};
+
+	return wavefrontRenderers[int(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
+}
+
+void Renderer::DispatchTiles(TileRenderer renderTile, const std::vector<Tile>& tiles) const
+{
+	m_NextTile = 0;
+
+	#if defined(PARALLEL_EXECUTION)
+		// One task per thread, each of them keeps pulling tiles until the frame is done
+		m_ThreadPool.ParallelFor(m_ThreadPool.GetThreadCount(), [this, renderTile, &tiles](uint32_t, uint32_t) { RenderTiles(renderTile, tiles); });
+	#else
+		RenderTiles(renderTile, tiles);
+	#endif
+}
+
+void Renderer::RenderTiles(TileRenderer renderTile, const std::vector<Tile>& tiles) const
+{
+	// Every thread keeps pulling the next tile until none are left, so fast tiles never leave a thread idle
+	for (uint32_t tileIndex{ m_NextTile++ }; tileIndex < tiles.size(); tileIndex = m_NextTile++)
+	{
+		(this->*renderTile)(tiles[tileIndex]);
+	}
+}
+
+bool Renderer::CollectDirtyTiles() const
+{
+	PROFILE_ZONE("Renderer::CollectDirtyTiles");
+	const FrameState frameState{ GetFrameState() };
+	FrameState expectedState{ m_RenderedFrame };
+	expectedState.sceneVersion = frameState.sceneVersion;
+
+	// The last frame has to show the scene as it was right before its latest Update, seen from the same camera with the same settings
+	if (!m_DirtyTilesEnabled || m_CostHeatmapEnabled || frameState.sceneVersion == m_RenderedFrame.sceneVersion || expectedState != frameState
+		|| !m_pScene->AreChangesBounded() || m_pScene->GetChangedBoundsVersion() != m_RenderedFrame.sceneVersion)
+	{
+		return false;
+	}
+
+	// Planes stop every ray that crosses them, so a moved object only matters on the side of each plane the camera is on,
+	// and its shadow only on the side the light is on. The margin covers the offset shadow rays start at
+	constexpr float planeMargin{ 0.01f };
+	constexpr float nearDistance{ 1e-5f };
+	constexpr float boxMargin{ 1e-4f };
+	const Vector3 cameraOrigin{ m_Camera->origin };
+	const Vector3 cameraForward{ m_Camera->cameraToWorld.GetAxisZ() };
+	const auto addPlaneSides{ [&](std::vector<HalfSpace>& halfSpaces, const Vector4& inside)
+		{
+			for (const Plane& plane : m_pScene->GetPlanes())
 			{
-				switch (m_CurrentLightingMode)
+				HalfSpace halfSpace{ MakeHalfSpace(plane.normal, plane.origin) };
+				if (!OrientHalfSpace(halfSpace, inside)) continue;
+
+				halfSpace.offset += planeMargin * plane.normal.Magnitude();
+				halfSpaces.emplace_back(halfSpace);
+			}
+		}
+	};
+
+	std::vector<HalfSpace> visibleSpace{ MakeHalfSpace(cameraForward, cameraOrigin + cameraForward * nearDistance) };
+	addPlaneSides(visibleSpace, Vector4{ cameraOrigin, 1.0f });
+
+	const Matrix worldToCamera{ Matrix::Inverse(m_Camera->cameraToWorld) };
+	const float scaleX{ 0.5f * float(m_Width) / (m_AscpectRatio * m_FieldOfVieuw) };
+	const float scaleY{ 0.5f * float(m_Height) / m_FieldOfVieuw };
+	std::vector<ScreenBounds> changedAreas{};
+
+	// Screen area of the convex region, or of one face of it, the inverse of GetCameraRayDirection for its corners in front of the camera
+	// and a whole side of the screen for corners at infinity parallel to the image plane
+	const auto addRegion{ [&](const std::vector<HalfSpace>& halfSpaces, bool faceOnly)
+		{
+			ScreenBounds bounds{ FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+			const auto addCorner{ [&](const Vector4& corner)
 				{
-				case dae::Renderer::LightingMode::ObservedArea:
-					if (observedArea > 0.0f)
+					const Vector3 point{ corner.w > 0.0f ? worldToCamera.TransformPoint(corner.x / corner.w, corner.y / corner.w, corner.z / corner.w)
+						: worldToCamera.TransformVector(corner.x, corner.y, corner.z) };
+
+					if (point.z > 0.0f)
 					{
-						color += colors::White * observedArea;
+						const float x{ 0.5f * float(m_Width) + (point.x / point.z) * scaleX };
+						const float y{ 0.5f * float(m_Height) - (point.y / point.z) * scaleY };
+						bounds.minX = std::min(bounds.minX, x);
+						bounds.minY = std::min(bounds.minY, y);
+						bounds.maxX = std::max(bounds.maxX, x);
+						bounds.maxY = std::max(bounds.maxY, y);
+						return;
 					}
-					break;
-				case dae::Renderer::LightingMode::Radiance:
-					color += LightUtils::GetRadiance(light, closestHit.origin);
-					break;
-				case dae::Renderer::LightingMode::BDRF:
-					color += m_Materials->at(closestHit.materialIndex)->Shade(closestHit, lightRay.direction, -cameraRayDirection);
-					break;
-				case dae::Renderer::LightingMode::Combined:
-					if (observedArea > 0.0f)
+
+					if (point.x > 0.0f) bounds.maxX = FLT_MAX;
+					if (point.x < 0.0f) bounds.minX = -FLT_MAX;
+					if (point.y > 0.0f) bounds.minY = -FLT_MAX;
+					if (point.y < 0.0f) bounds.maxY = FLT_MAX;
+				}
+			};
+
+			if (faceOnly) VisitFaceCorners(halfSpaces, halfSpaces.size() - 1, addCorner);
+			else VisitRegionCorners(halfSpaces, addCorner);
+
+			if (bounds.minX <= bounds.maxX) changedAreas.emplace_back(bounds);
+		}
+	};
+
+	// Shadows only change on surfaces: the planes, and the bounded primitives which all lie inside the scene bounds
+	Vector3 sceneMinBounds{};
+	Vector3 sceneMaxBounds{};
+	const bool hasBoundedPrimitives{ m_pScene->GetBounds(sceneMinBounds, sceneMaxBounds) };
+	const auto addShadowRegion{ [&](std::vector<HalfSpace>& region)
+		{
+			for (const Plane& plane : m_pScene->GetPlanes())
+			{
+				region.emplace_back(MakeHalfSpace(plane.normal, plane.origin));
+				addRegion(region, true);
+				region.pop_back();
+			}
+
+			if (!hasBoundedPrimitives) return;
+
+			for (uint32_t axis{}; axis < 3; ++axis)
+			{
+				Vector3 normal{};
+				normal[axis] = 1.0f;
+				region.emplace_back(MakeHalfSpace(normal, sceneMinBounds - normal * planeMargin));
+				region.emplace_back(MakeHalfSpace(-normal, sceneMaxBounds + normal * planeMargin));
+			}
+			addRegion(region, false);
+		}
+	};
+
+	for (const Scene::ChangedBounds& changed : m_pScene->GetChangedBounds())
+	{
+		// Grown a little, so a sphere shrunk to a point still has faces to sweep
+		const Vector3 margin{ boxMargin, boxMargin, boxMargin };
+		const Vector3 minBounds{ changed.minBounds - margin };
+		const Vector3 maxBounds{ changed.maxBounds + margin };
+		const Vector3 center{ (minBounds + maxBounds) * 0.5f };
+
+		// The object itself, where camera rays hit it
+		std::vector<HalfSpace> region{ visibleSpace };
+		for (uint32_t axis{}; axis < 3; ++axis)
+		{
+			Vector3 normal{};
+			normal[axis] = 1.0f;
+			region.emplace_back(MakeHalfSpace(normal, minBounds));
+			region.emplace_back(MakeHalfSpace(-normal, maxBounds));
+		}
+		addRegion(region, false);
+
+		if (!m_ShadowsEnabled) continue;
+
+		// Everything behind it as seen from each light, where shadow rays pass through it. That is the box swept away from the light,
+		// which is the union of the faces turned away from the light each swept along the light rays through its corners
+		for (const Light& light : *m_Lights)
+		{
+			const bool isDirectional{ light.type == LightType::Directional };
+			const Vector4 lightPoint{ isDirectional ? Vector4{ -light.direction, 0.0f } : Vector4{ light.origin, 1.0f } };
+
+			if (!isDirectional && light.origin.x >= minBounds.x && light.origin.y >= minBounds.y && light.origin.z >= minBounds.z
+				&& light.origin.x <= maxBounds.x && light.origin.y <= maxBounds.y && light.origin.z <= maxBounds.z)
+			{
+				// A light inside the box casts its shadow in every direction
+				return false;
+			}
+
+			std::vector<HalfSpace> shadowSpace{ visibleSpace };
+			addPlaneSides(shadowSpace, lightPoint);
+
+			for (uint32_t face{}; face < 6; ++face)
+			{
+				const uint32_t axis{ face / 2 };
+				const bool isMaxFace{ (face & 1) != 0 };
+				Vector3 normal{};
+				normal[axis] = isMaxFace ? 1.0f : -1.0f;
+
+				const Vector3 facePoint{ isMaxFace ? maxBounds : minBounds };
+				HalfSpace beyondFace{ MakeHalfSpace(normal, facePoint) };
+				if (beyondFace.Distance(lightPoint) >= 0.0f) continue;
+
+				// Corners of the face in order around it
+				const uint32_t axisU{ (axis + 1) % 3 };
+				const uint32_t axisV{ (axis + 2) % 3 };
+				Vector3 corners[4]{ facePoint, facePoint, facePoint, facePoint };
+				corners[0][axisU] = minBounds[axisU]; corners[0][axisV] = minBounds[axisV];
+				corners[1][axisU] = maxBounds[axisU]; corners[1][axisV] = minBounds[axisV];
+				corners[2][axisU] = maxBounds[axisU]; corners[2][axisV] = maxBounds[axisV];
+				corners[3][axisU] = minBounds[axisU]; corners[3][axisV] = maxBounds[axisV];
+
+				region = shadowSpace;
+				region.emplace_back(beyondFace);
+
+				const Vector3 faceCenter{ center + normal * (0.5f * (maxBounds[axis] - minBounds[axis])) };
+				for (uint32_t edge{}; edge < 4; ++edge)
+				{
+					const Vector3& start{ corners[edge] };
+					const Vector3& end{ corners[(edge + 1) % 4] };
+					const Vector3 sweep{ isDirectional ? light.direction : start - light.origin };
+
+					HalfSpace side{ MakeHalfSpace(Vector3::Cross(end - start, sweep), start) };
+					if (OrientHalfSpace(side, Vector4{ faceCenter, 1.0f })) region.emplace_back(side);
+				}
+
+				addShadowRegion(region);
+			}
+		}
+	}
+
+	// Kept in the Morton order of m_Tiles, widened by a pixel so rounding in the projection never drops the edge of an object
+	m_DirtyTiles.clear();
+	for (const Tile& tile : m_Tiles)
+	{
+		for (const ScreenBounds& area : changedAreas)
+		{
+			if (float(tile.x + tile.width) + 1.0f > area.minX && float(tile.x) - 1.0f < area.maxX
+				&& float(tile.y + tile.height) + 1.0f > area.minY && float(tile.y) - 1.0f < area.maxY)
+			{
+				m_DirtyTiles.emplace_back(tile);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void Renderer::RenderTile(const Tile& tile) const
+{
+	PROFILE_TILE_ZONE();
+	uint64_t rayCount{};
+
+	for (uint32_t py{ tile.y }; py < tile.y + tile.height; ++py)
+	{
+		for (uint32_t px{ tile.x }; px < tile.x + tile.width; ++px)
+		{
+			if (m_CostHeatmapEnabled)
+			{
+				const uint64_t start{ ReadCostCounter() };
+				rayCount += RenderPixel<lightingMode, shadowsEnabled>(px, py);
+				m_PixelCosts[px + (py * m_Width)] = uint32_t(std::min<uint64_t>(ReadCostCounter() - start, UINT32_MAX));
+			}
+			else
+			{
+				rayCount += RenderPixel<lightingMode, shadowsEnabled>(px, py);
+			}
+		}
+	}
+
+	m_RayCount.fetch_add(rayCount, std::memory_order_relaxed);
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void Renderer::RenderTileSorted(const Tile& tile) const
+{
+	PROFILE_TILE_ZONE();
+
+	// Grown to the tile size once per thread and reused for every tile after that
+	thread_local std::vector<ShadingSample> samples{};
+	thread_local std::vector<ShadingSample> sortedSamples{};
+	thread_local std::vector<uint32_t> materialOffsets{};
+	uint64_t rayCount{};
+
+	// Pass 1: trace every camera ray of the tile, misses are written right away
+	samples.clear();
+	for (uint32_t py{ tile.y }; py < tile.y + tile.height; ++py)
+	{
+		for (uint32_t px{ tile.x }; px < tile.x + tile.width; ++px)
+		{
+			const Vector3 cameraRayDirection{ GetCameraRayDirection(px, py) };
+			HitRecord closestHit{};
+			{
+				PROFILE_PIXEL_ZONE(ClosestHit);
+				m_pScene->GetClosestHit(Ray{ m_Camera->origin, cameraRayDirection }, closestHit);
+			}
+			++rayCount;
+
+			if (closestHit.didHit) samples.emplace_back(ShadingSample{ closestHit, cameraRayDirection, px + (py * m_Width) });
+			else WritePixel(px + (py * m_Width), colors::Black);
+		}
+	}
+
+	// Counting sort on material index, every material's hits end up next to each other in pixel order
+	materialOffsets.assign(m_Materials->size() + 1, 0);
+	for (const ShadingSample& sample : samples) ++materialOffsets[sample.hitRecord.materialIndex + 1];
+	std::partial_sum(materialOffsets.begin(), materialOffsets.end(), materialOffsets.begin());
+
+	sortedSamples.resize(samples.size());
+	for (const ShadingSample& sample : samples) sortedSamples[materialOffsets[sample.hitRecord.materialIndex]++] = sample;
+
+	// Pass 2: shade one material at a time, so the same BRDF code and variant branch run back to back
+	for (const ShadingSample& sample : sortedSamples)
+	{
+		uint32_t shadowRayCount{};
+		WritePixel(sample.pixelIndex, ShadeHit<lightingMode, shadowsEnabled>(sample.hitRecord, sample.cameraRayDirection, shadowRayCount));
+		rayCount += shadowRayCount;
+	}
+
+	m_RayCount.fetch_add(rayCount, std::memory_order_relaxed);
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void Renderer::RenderTilePackets(const Tile& tile) const
+{
+	PROFILE_TILE_ZONE();
+	uint64_t rayCount{};
+
+	for (uint32_t py{ tile.y }; py < tile.y + tile.height; py += RayPacket::Rows)
+	{
+		for (uint32_t px{ tile.x }; px < tile.x + tile.width; px += RayPacket::Columns)
+		{
+			RayPacket packet{};
+			packet.origin = m_Camera->origin;
+
+			// Lanes that fall outside the tile repeat its last row or column, so the corners of the packet still span a valid frustum
+			for (uint32_t lane{}; lane < RayPacket::Width; ++lane)
+			{
+				const uint32_t x{ px + lane % RayPacket::Columns };
+				const uint32_t y{ py + lane / RayPacket::Columns };
+				if (x < tile.x + tile.width && y < tile.y + tile.height) packet.activeMask |= 1u << lane;
+
+				const Vector3 direction{ GetCameraRayDirection(std::min(x, tile.x + tile.width - 1), std::min(y, tile.y + tile.height - 1)) };
+				packet.directionX[lane] = direction.x;
+				packet.directionY[lane] = direction.y;
+				packet.directionZ[lane] = direction.z;
+			}
+
+			HitRecord closestHits[RayPacket::Width];
+			{
+				PROFILE_PIXEL_ZONE(ClosestHit);
+				m_pScene->GetClosestHit(packet, closestHits);
+			}
+
+			for (uint32_t lanes{ packet.activeMask }; lanes != 0; lanes &= lanes - 1)
+			{
+				const uint32_t lane{ uint32_t(std::countr_zero(lanes)) };
+				const Vector3 cameraRayDirection{ packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane] };
+				ColorRGB color{ colors::Black };
+				uint32_t pixelRayCount{ 1 };
+
+				if (closestHits[lane].didHit)
+				{
+					color = ShadeHit<lightingMode, shadowsEnabled>(closestHits[lane], cameraRayDirection, pixelRayCount);
+				}
+
+				WritePixel(px + lane % RayPacket::Columns + ((py + lane / RayPacket::Columns) * m_Width), color);
+				rayCount += pixelRayCount;
+			}
+		}
+	}
+
+	m_RayCount.fetch_add(rayCount, std::memory_order_relaxed);
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void Renderer::RenderWavefront() const
+{
+	PROFILE_ZONE("Renderer::RenderWavefront");
+	const uint32_t lightCount{ uint32_t(m_Lights->size()) };
+	uint64_t rayCount{ m_NrOfPixels };
+
+	// Pass 1: every camera ray of the frame, still tile by tile so packets stay coherent
+	m_WavefrontHits.resize(m_NrOfPixels);
+	DispatchTiles(&Renderer::TraceTileWavefront, m_Tiles);
+
+	// Pass 2: one shadow ray stream per light, sorted and traced in bulk so neighbouring rays walk the same nodes one after the other
+	if constexpr (shadowsEnabled)
+	{
+		PROFILE_ZONE("Renderer::ShadowRayStreams");
+		Vector3 minOrigin{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 maxOrigin{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		uint32_t hitCount{};
+
+		for (const HitRecord& hit : m_WavefrontHits)
+		{
+			if (!hit.didHit) continue;
+
+			minOrigin = Vector3::Min(minOrigin, hit.origin);
+			maxOrigin = Vector3::Max(maxOrigin, hit.origin);
+			++hitCount;
+		}
+
+		m_ShadowOcclusion.assign(size_t(m_NrOfPixels) * lightCount, 0);
+		for (uint32_t lightIndex{}; lightIndex < lightCount; ++lightIndex)
+		{
+			TraceShadowRayStream((*m_Lights)[lightIndex], lightIndex, minOrigin, maxOrigin, hitCount);
+		}
+
+		rayCount += uint64_t(hitCount) * lightCount;
+	}
+
+	// Pass 3: shade every pixel with the occlusion the streams left behind
+	{
+		PROFILE_ZONE("Renderer::WavefrontShading");
+		m_ThreadPool.ParallelFor(m_NrOfPixels, [&](uint32_t begin, uint32_t end)
+			{
+				PROFILE_TILE_ZONE();
+				for (uint32_t pixelIndex{ begin }; pixelIndex < end; ++pixelIndex)
+				{
+					const HitRecord& closestHit{ m_WavefrontHits[pixelIndex] };
+					ColorRGB color{ colors::Black };
+
+					if (closestHit.didHit)
 					{
-						color += LightUtils::GetRadiance(light, closestHit.origin) *
-							m_Materials->at(closestHit.materialIndex)->Shade(closestHit, lightRay.direction, -cameraRayDirection) *
-							observedArea;
+						const uint8_t* lightOcclusion{ shadowsEnabled ? &m_ShadowOcclusion[size_t(pixelIndex) * lightCount] : nullptr };
+						color = ShadeHit<lightingMode, shadowsEnabled>(closestHit, GetCameraRayDirection(pixelIndex), lightOcclusion);
 					}
-					break;
+
+					WritePixel(pixelIndex, color);
+				}
+			}, 1024
+		);
+	}
+
+	m_RayCount = rayCount;
+}
+
+void Renderer::TraceTileWavefront(const Tile& tile) const
+{
+	PROFILE_TILE_ZONE();
+
+	if (!m_PacketTracingEnabled)
+	{
+		for (uint32_t py{ tile.y }; py < tile.y + tile.height; ++py)
+		{
+			for (uint32_t px{ tile.x }; px < tile.x + tile.width; ++px)
+			{
+				const uint32_t pixelIndex{ px + (py * m_Width) };
+				const Vector3 cameraRayDirection{ GetCameraRayDirection(pixelIndex) };
+				m_WavefrontHits[pixelIndex] = HitRecord{};
+
+				PROFILE_PIXEL_ZONE(ClosestHit);
+				m_pScene->GetClosestHit(Ray{ m_Camera->origin, cameraRayDirection }, m_WavefrontHits[pixelIndex]);
+			}
+		}
+
+		return;
+	}
+
+	for (uint32_t py{ tile.y }; py < tile.y + tile.height; py += RayPacket::Rows)
+	{
+		for (uint32_t px{ tile.x }; px < tile.x + tile.width; px += RayPacket::Columns)
+		{
+			RayPacket packet{};
+			packet.origin = m_Camera->origin;
+
+			// Same edge handling as RenderTilePackets
+			for (uint32_t lane{}; lane < RayPacket::Width; ++lane)
+			{
+				const uint32_t x{ px + lane % RayPacket::Columns };
+				const uint32_t y{ py + lane / RayPacket::Columns };
+				if (x < tile.x + tile.width && y < tile.y + tile.height) packet.activeMask |= 1u << lane;
+
+				const Vector3 direction{ GetCameraRayDirection(std::min(x, tile.x + tile.width - 1), std::min(y, tile.y + tile.height - 1)) };
+				packet.directionX[lane] = direction.x;
+				packet.directionY[lane] = direction.y;
+				packet.directionZ[lane] = direction.z;
+			}
+
+			HitRecord closestHits[RayPacket::Width];
+			{
+				PROFILE_PIXEL_ZONE(ClosestHit);
+				m_pScene->GetClosestHit(packet, closestHits);
+			}
+
+			for (uint32_t lanes{ packet.activeMask }; lanes != 0; lanes &= lanes - 1)
+			{
+				const uint32_t lane{ uint32_t(std::countr_zero(lanes)) };
+				const uint32_t pixelIndex{ px + lane % RayPacket::Columns + ((py + lane / RayPacket::Columns) * m_Width) };
+
+				m_WavefrontHits[pixelIndex] = closestHits[lane];
+			}
+		}
+	}
+}
+
+void Renderer::TraceShadowRayStream(const Light& light, uint32_t lightIndex, const Vector3& minOrigin, const Vector3& maxOrigin, uint32_t hitCount) const
+{
+	// Origins fall into a 32x32x32 grid over the bounds of all hits, fine enough that a cell covers a small part of the scene and coarse enough
+	// that the stable sort keeps the pixels of a cell in scanline order, so reading hits and writing occlusion stays mostly sequential
+	// Misses get a key above every cell so they sort to the end
+	constexpr uint32_t cellBits{ 5 };
+	constexpr uint32_t keyBits{ 3 * cellBits + 3 };
+	constexpr uint32_t missKey{ 1u << keyBits };
+	constexpr float maxCell{ float((1u << cellBits) - 1) };
+	const Vector3 extent{ maxOrigin - minOrigin };
+	const Vector3 cellScale{ extent.x > 0.0f ? maxCell / extent.x : 0.0f, extent.y > 0.0f ? maxCell / extent.y : 0.0f, extent.z > 0.0f ? maxCell / extent.z : 0.0f };
+
+	m_ShadowRayStream.resize(m_NrOfPixels);
+	m_ThreadPool.ParallelFor(m_NrOfPixels, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t pixelIndex{ begin }; pixelIndex < end; ++pixelIndex)
+			{
+				const HitRecord& hit{ m_WavefrontHits[pixelIndex] };
+				if (!hit.didHit)
+				{
+					m_ShadowRayStream[pixelIndex] = ShadowRayKey{ missKey, pixelIndex };
+					continue;
 				}
+
+				const Vector3 direction{ LightUtils::GetDirectionToLight(light, hit.origin) };
+				const uint32_t mortonCode{ SpreadBits3(uint32_t((hit.origin.x - minOrigin.x) * cellScale.x))
+					| (SpreadBits3(uint32_t((hit.origin.y - minOrigin.y) * cellScale.y)) << 1)
+					| (SpreadBits3(uint32_t((hit.origin.z - minOrigin.z) * cellScale.z)) << 2) };
+				const uint32_t octant{ (direction.x < 0.0f ? 1u : 0u) | (direction.y < 0.0f ? 2u : 0u) | (direction.z < 0.0f ? 4u : 0u) };
+
+				m_ShadowRayStream[pixelIndex] = ShadowRayKey{ (mortonCode << 3) | octant, pixelIndex };
+			}
+		}, 4096
+	);
+
+	RadixSortByKey(m_ShadowRayStream, m_ShadowRayScratch, keyBits + 1);
+
+	const uint32_t lightCount{ uint32_t(m_Lights->size()) };
+	m_ThreadPool.ParallelFor(hitCount, [&](uint32_t begin, uint32_t end)
+		{
+			// Chunks are timed like tiles, so the shadow ray stage shows up in traces the same way
+			PROFILE_TILE_ZONE();
+			for (uint32_t index{ begin }; index < end; ++index)
+			{
+				const uint32_t pixelIndex{ m_ShadowRayStream[index].pixelIndex };
+				Vector3 lightRayDirection{};
+
+				PROFILE_PIXEL_ZONE(ShadowRays);
+				m_ShadowOcclusion[size_t(pixelIndex) * lightCount + lightIndex] = m_pScene->IsOccluded(GetLightRay(light, m_WavefrontHits[pixelIndex].origin, lightRayDirection)) ? 1 : 0;
+			}
+		}, 1024
+	);
+}
+
+void Renderer::UpscaleFramebuffer() const
+{
+	PROFILE_ZONE("Renderer::UpscaleFramebuffer");
+	const Framebuffer& source{ m_Framebuffer };
+	Framebuffer& output{ m_OutputFramebuffer };
+
+	std::vector<FilterTap> columnTaps(output.width);
+	for (uint32_t x{}; x < output.width; ++x)
+	{
+		columnTaps[x] = GetFilterTap(x, output.width, source.width);
+	}
+
+	m_ThreadPool.ParallelFor(output.height, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y{ begin }; y < end; ++y)
+			{
+				const FilterTap rowTap{ GetFilterTap(y, output.height, source.height) };
+				const uint32_t* const pFirstRow{ source.pixels.data() + size_t(rowTap.first) * source.width };
+				const uint32_t* const pSecondRow{ source.pixels.data() + size_t(rowTap.second) * source.width };
+				uint32_t* const pOutputRow{ output.pixels.data() + size_t(y) * output.width };
+
+				for (uint32_t x{}; x < output.width; ++x)
+				{
+					const FilterTap& tap{ columnTaps[x] };
+					const uint32_t top{ BlendPixels(pFirstRow[tap.first], pFirstRow[tap.second], tap.weight) };
+					const uint32_t bottom{ BlendPixels(pSecondRow[tap.first], pSecondRow[tap.second], tap.weight) };
+					pOutputRow[x] = BlendPixels(top, bottom, rowTap.weight);
+				}
+			}
+		}, 16
+	);
+}
+
+void Renderer::DrawCostHeatmap() const
+{
+	PROFILE_ZONE("Renderer::DrawCostHeatmap");
+
+	// Scaled to the 99th percentile instead of the maximum, so a single preempted pixel does not turn the rest of the frame blue
+	std::vector<uint32_t> sortedCosts{ m_PixelCosts };
+	const auto percentile{ sortedCosts.begin() + (sortedCosts.size() * 99) / 100 };
+	std::nth_element(sortedCosts.begin(), percentile, sortedCosts.end());
+	const float costScale{ 1.0f / float(std::max(1u, *percentile)) };
+
+	m_ThreadPool.ParallelFor(m_NrOfPixels, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t pixel{ begin }; pixel < end; ++pixel)
+			{
+				m_Framebuffer.pixels[pixel] = HeatmapColor(float(m_PixelCosts[pixel]) * costScale);
 			}
+		}, 4096
+	);
+}
+
+float Renderer::LambertsCosineLaw(const dae::Vector3& normalSurface, const dae::Vector3& incomingLight, float incomingLightMagnitude) const
+{
+	return (Vector3::Dot(normalSurface, incomingLight) / incomingLightMagnitude);
+}
 
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+uint32_t Renderer::RenderPixel(uint32_t px, uint32_t py) const
+{
+	uint32_t rayCount{ 1 };
+	const Vector3 cameraRayDirection{ GetCameraRayDirection(px, py) };
+	Ray cameraRay{ m_Camera->origin, cameraRayDirection };
+
+	ColorRGB color{ colors::Black };
+	HitRecord closestHit{};
+
+	{
+		PROFILE_PIXEL_ZONE(ClosestHit);
+		m_pScene->GetClosestHit(cameraRay, closestHit);
+	}
+
+	if (closestHit.didHit)
+	{
+		color = ShadeHit<lightingMode, shadowsEnabled>(closestHit, cameraRayDirection, rayCount);
+	}
+
+	WritePixel(px + (py * m_Width), color);
+	return rayCount;
+}
+
+void Renderer::UpdateCameraRayDirections() const
+{
+	PROFILE_ZONE("Renderer::UpdateCameraRayDirections");
+	const uint32_t blockCount{ (m_NrOfPixels + Float8::Width - 1) / Float8::Width };
+	bool rotationChanged{ false };
+
+	// The camera space table only has to be redone when the field of view changes, SetResolutionScale clears it for a new resolution
+	if (m_CameraSpaceDirections.size() != blockCount || m_DirectionTableFovAngle != m_Camera->fovAngle)
+	{
+		m_DirectionTableFovAngle = m_Camera->fovAngle;
+		m_FieldOfVieuw = tanf((dae::TO_RADIANS * m_Camera->fovAngle) / 2);
+		m_CameraSpaceDirections.assign(blockCount, DirectionBlock{});
+		m_CameraRayDirections.resize(blockCount);
+
+		// The padding lanes of the last block repeat the last pixel
+		for (uint32_t pixelIndex{}; pixelIndex < blockCount * Float8::Width; ++pixelIndex)
+		{
+			const uint32_t clampedIndex{ std::min(pixelIndex, m_NrOfPixels - 1) };
+			const float rx{ clampedIndex % m_Width + 0.5f }, ry{ clampedIndex / m_Width + 0.5f };
+			const float worldX{ (2 * (rx / float(m_Width)) - 1) * m_AscpectRatio * m_FieldOfVieuw };
+			const float worldY{ (1 - (2 * (ry / float(m_Height)))) * m_FieldOfVieuw };
+			const Vector3 direction{ Vector3{ worldX, worldY, 1.0f }.Normalized() };
+
+			DirectionBlock& block{ m_CameraSpaceDirections[pixelIndex / Float8::Width] };
+			block.x[pixelIndex % Float8::Width] = direction.x;
+			block.y[pixelIndex % Float8::Width] = direction.y;
+			block.z[pixelIndex % Float8::Width] = direction.z;
 		}
+
+		rotationChanged = true;
 	}
 
+	// The origin is not part of the table, so a camera that only moved keeps last frame's directions as they are
+	const Matrix& cameraToWorld{ m_Camera->cameraToWorld };
+	const Vector3 axes[3]{ cameraToWorld.GetAxisX(), cameraToWorld.GetAxisY(), cameraToWorld.GetAxisZ() };
+	for (uint32_t axis{}; axis < 3; ++axis)
+	{
+		rotationChanged |= axes[axis].x != m_DirectionTableAxes[axis].x || axes[axis].y != m_DirectionTableAxes[axis].y || axes[axis].z != m_DirectionTableAxes[axis].z;
+		m_DirectionTableAxes[axis] = axes[axis];
+	}
+
+	if (!rotationChanged) return;
+
+	// Same products in the same order as Matrix::TransformVector, so the rotated directions match it bit for bit
+	m_ThreadPool.ParallelFor(blockCount, [&](uint32_t begin, uint32_t end)
+		{
+			const Float8 right[3]{ Float8::Broadcast(axes[0].x), Float8::Broadcast(axes[0].y), Float8::Broadcast(axes[0].z) };
+			const Float8 up[3]{ Float8::Broadcast(axes[1].x), Float8::Broadcast(axes[1].y), Float8::Broadcast(axes[1].z) };
+			const Float8 forward[3]{ Float8::Broadcast(axes[2].x), Float8::Broadcast(axes[2].y), Float8::Broadcast(axes[2].z) };
+
+			for (uint32_t blockIndex{ begin }; blockIndex < end; ++blockIndex)
+			{
+				const DirectionBlock& cameraSpace{ m_CameraSpaceDirections[blockIndex] };
+				const Float8 x{ Float8::Load(cameraSpace.x) };
+				const Float8 y{ Float8::Load(cameraSpace.y) };
+				const Float8 z{ Float8::Load(cameraSpace.z) };
+
+				DirectionBlock& worldSpace{ m_CameraRayDirections[blockIndex] };
+				Float8::Store(worldSpace.x, right[0] * x + up[0] * y + forward[0] * z);
+				Float8::Store(worldSpace.y, right[1] * x + up[1] * y + forward[1] * z);
+				Float8::Store(worldSpace.z, right[2] * x + up[2] * y + forward[2] * z);
+			}
+		}, 1024
+	);
+}
+
+Vector3 Renderer::GetCameraRayDirection(uint32_t pixelIndex) const
+{
+	PROFILE_PIXEL_ZONE(CameraRay);
+	const DirectionBlock& block{ m_CameraRayDirections[pixelIndex / Float8::Width] };
+	const uint32_t lane{ pixelIndex % Float8::Width };
+
+	return Vector3{ block.x[lane], block.y[lane], block.z[lane] };
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+ColorRGB Renderer::ShadeHit(const HitRecord& closestHit, const Vector3& cameraRayDirection, uint32_t& rayCount) const
+{
+	ColorRGB color{ colors::Black };
+
+	for (const Light& light : *m_Lights)
+	{
+		Vector3 lightRayDirection{};
+		const Ray lightRay{ GetLightRay(light, closestHit.origin, lightRayDirection) };
+
+		bool isShadowed{ false };
+		if constexpr (shadowsEnabled)
+		{
+			PROFILE_PIXEL_ZONE(ShadowRays);
+			isShadowed = m_pScene->IsOccluded(lightRay);
+			++rayCount;
+		}
+
+		ShadeLight<lightingMode>(color, closestHit, cameraRayDirection, light, lightRayDirection, lightRay, isShadowed);
+	}
+
+	return color;
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+ColorRGB Renderer::ShadeHit(const HitRecord& closestHit, const Vector3& cameraRayDirection, const uint8_t* lightOcclusion) const
+{
+	ColorRGB color{ colors::Black };
+
+	for (uint32_t lightIndex{}; lightIndex < m_Lights->size(); ++lightIndex)
+	{
+		const Light& light{ (*m_Lights)[lightIndex] };
+		Vector3 lightRayDirection{};
+		const Ray lightRay{ GetLightRay(light, closestHit.origin, lightRayDirection) };
+
+		bool isShadowed{ false };
+		if constexpr (shadowsEnabled) isShadowed = lightOcclusion[lightIndex] != 0;
+
+		ShadeLight<lightingMode>(color, closestHit, cameraRayDirection, light, lightRayDirection, lightRay, isShadowed);
+	}
+
+	return color;
+}
+
+template<Renderer::LightingMode lightingMode>
+void Renderer::ShadeLight(ColorRGB& color, const HitRecord& closestHit, const Vector3& cameraRayDirection, const Light& light, const Vector3& lightRayDirection,
+	const Ray& lightRay, bool isShadowed) const
+{
+	if (isShadowed)
+	{
+		color *= 0.5f;
+		return;
+	}
+
+	PROFILE_PIXEL_ZONE(Shading);
+	const float lightRayDirectionMagnitude{ lightRay.max };
+
+	if constexpr (lightingMode == LightingMode::ObservedArea)
+	{
+		const float observedArea{ LambertsCosineLaw(closestHit.normal, lightRayDirection, lightRayDirectionMagnitude) };
+		if (observedArea > 0.0f)
+		{
+			color += colors::White * observedArea;
+		}
+	}
+	else if constexpr (lightingMode == LightingMode::Radiance)
+	{
+		color += LightUtils::GetRadiance(light, closestHit.origin);
+	}
+	else if constexpr (lightingMode == LightingMode::BDRF)
+	{
+		color += Shade((*m_Materials)[closestHit.materialIndex], closestHit, lightRay.direction, -cameraRayDirection);
+	}
+	else
+	{
+		const float observedArea{ LambertsCosineLaw(closestHit.normal, lightRayDirection, lightRayDirectionMagnitude) };
+		if (observedArea > 0.0f)
+		{
+			color += LightUtils::GetRadiance(light, closestHit.origin) *
+				Shade((*m_Materials)[closestHit.materialIndex], closestHit, lightRay.direction, -cameraRayDirection) *
+				observedArea;
+		}
+	}
+}
+
+void Renderer::WritePixel(uint32_t pixelIndex, ColorRGB color) const
+{
+	PROFILE_PIXEL_ZONE(PixelPacking);
 	color.MaxToOne();
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format, static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255));
+	m_Framebuffer.pixels[pixelIndex] = Framebuffer::PackRGB(static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255));
 }
\ No newline at end of file
@@ -1,20 +1,30 @@
 #pragma once
 #include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
 #include "Math.h"
 #include "Material.h"
 #include "Scene.h"
 #include "DataTypes.h"
 #include "Camera.h"
-
-struct SDL_Window;
-struct SDL_Surface;
+#include "ThreadPool.h"
+#include "Framebuffer.h"
 
 namespace dae
 {
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		enum class LightingMode
+		{
+			ObservedArea,
+			Radiance,
+			BDRF,
+			Combined
+		};
+
+		Renderer(uint32_t width, uint32_t height);
 		~Renderer() = default;
 
 		Renderer(const Renderer&) = delete;
@@ -24,36 +34,188 @@ namespace dae
 
 		void SetScene(Scene* pScene);
 		void Render() const;
+		/**
+		 * \brief True when the scene, its camera, the lighting mode, the shadows or the heatmap changed since the last Render call
+		 * Lets a caller skip Render while the framebuffer still shows the current state, the shading order settings give the same image and are not compared
+		 */
+		bool IsFrameOutdated() const;
 		bool SaveBufferToImage() const;
+		const Framebuffer& GetFramebuffer() const { return IsUpscaling() ? m_OutputFramebuffer : m_Framebuffer; }	// Always at the size the renderer was created with
+		uint64_t GetRayCount() const { return m_RayCount; }	// Camera and shadow rays traced by the last Render call
 		void CycleLigtingMode();
 		void ToggleShadows();
+		void SetLightingMode(LightingMode lightingMode) { m_CurrentLightingMode = lightingMode; }
+		void SetShadowsEnabled(bool shadowsEnabled) { m_ShadowsEnabled = shadowsEnabled; }
+		LightingMode GetLightingMode() const { return m_CurrentLightingMode; }
+		bool AreShadowsEnabled() const { return m_ShadowsEnabled; }
+		/**
+		 * \brief Switches to tiles that trace all camera rays first and then shade the hits grouped per material
+		 */
+		void ToggleSortedShading();
+		void SetSortedShadingEnabled(bool sortedShadingEnabled) { m_SortedShadingEnabled = sortedShadingEnabled; }
+		bool IsSortedShadingEnabled() const { return m_SortedShadingEnabled; }
+		/**
+		 * \brief Switches between tracing camera rays in packets of 4 by 2 pixels and tracing them one at a time
+		 */
+		void TogglePacketTracing();
+		void SetPacketTracingEnabled(bool packetTracingEnabled) { m_PacketTracingEnabled = packetTracingEnabled; }
+		bool IsPacketTracingEnabled() const { return m_PacketTracingEnabled; }
+		/**
+		 * \brief Switches to rendering the frame in passes: every camera ray, then one shadow ray stream per light sorted by origin and direction, then the shading
+		 */
+		void ToggleWavefront();
+		void SetWavefrontEnabled(bool wavefrontEnabled) { m_WavefrontEnabled = wavefrontEnabled; }
+		bool IsWavefrontEnabled() const { return m_WavefrontEnabled; }
+		/**
+		 * \brief Switches between redrawing only the tiles that moved objects and their shadows cover while the camera stands still, and redrawing every tile
+		 */
+		void ToggleDirtyTiles();
+		void SetDirtyTilesEnabled(bool dirtyTilesEnabled) { m_DirtyTilesEnabled = dirtyTilesEnabled; }
+		bool AreDirtyTilesEnabled() const { return m_DirtyTilesEnabled; }
+		float GetRenderedTileFraction() const { return m_RenderedTileFraction; }	// Share of the tiles the last Render call traced, 1 for a full frame
+		void ToggleCostHeatmap();
+		bool IsCostHeatmapEnabled() const { return m_CostHeatmapEnabled; }
+		const std::vector<uint32_t>& GetPixelCosts() const { return m_PixelCosts; }	// Filled while the cost heatmap is enabled
+		bool SaveCostBuffer(const std::string& filename) const;
+		/**
+		 * \brief Renders at this fraction of the width and height the renderer was created with and upscales the result bilinearly to that size
+		 * Resizing rebuilds the tiles and the camera ray table and forces the next frame to be redrawn in full, so callers should not change it every frame by tiny amounts
+		 */
+		void SetResolutionScale(float resolutionScale);
+		float GetResolutionScale() const { return float(m_Width) / float(m_OutputFramebuffer.width); }
+		uint32_t GetRenderWidth() const { return uint32_t(m_Width); }
+		uint32_t GetRenderHeight() const { return uint32_t(m_Height); }
+		void SetTileSize(uint32_t tileSize);
+		void SetThreadCount(uint32_t threadCount);
+		void SetThreadPinning(bool pinThreads);
+		uint32_t GetTileSize() const { return m_TileSize; }
+		uint32_t GetThreadCount() const { return m_ThreadPool.GetThreadCount(); }
+		ThreadPool& GetThreadPool() { return m_ThreadPool; }
 
 	private:
-		enum class LightingMode
+		struct Tile
 		{
-			ObservedArea,
-			Radiance,
-			BDRF,
-			Combined
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+			uint32_t height;
 		};
 
-		SDL_Window* m_pWindow;
-		SDL_Surface* m_pBuffer;
-		uint32_t* m_pBufferPixels; 
+		// Camera ray hit waiting for the shading pass of a material sorted tile
+		struct ShadingSample
+		{
+			HitRecord hitRecord;
+			Vector3 cameraRayDirection;
+			uint32_t pixelIndex;
+		};
+
+		// Entry of a wavefront shadow ray stream, the ray itself is rebuilt from the camera hit of the pixel when it is traced
+		struct ShadowRayKey
+		{
+			uint32_t key;			// Morton code of the ray origin followed by the octant of its direction
+			uint32_t pixelIndex;
+		};
+
+		// Everything the image depends on, recorded by Render for IsFrameOutdated
+		struct FrameState
+		{
+			const Scene* pScene;
+			uint64_t sceneVersion;
+			uint32_t cameraVersion;
+			LightingMode lightingMode;
+			bool shadowsEnabled;
+			bool costHeatmapEnabled;
+			int width;
+			int height;
+
+			bool operator==(const FrameState& other) const = default;
+		};
+
+		// Directions of eight neighbouring pixels in scanline order, split per axis so the whole block rotates with three Float8 products per axis
+		struct alignas(32) DirectionBlock
+		{
+			float x[Float8::Width];
+			float y[Float8::Width];
+			float z[Float8::Width];
+		};
+
+		mutable Framebuffer m_Framebuffer;			// At the render resolution
+		mutable Framebuffer m_OutputFramebuffer;	// At the size the renderer was created with, filled by the upscale while the resolution scale is below 1
 		int m_Width; 
 		int m_Height;
 		LightingMode m_CurrentLightingMode;
 		bool m_ShadowsEnabled;
+		bool m_CostHeatmapEnabled;
+		bool m_SortedShadingEnabled;
+		bool m_PacketTracingEnabled;
+		bool m_WavefrontEnabled;
+		bool m_DirtyTilesEnabled;
 		const Scene* m_pScene;
 		Camera* m_Camera;
-		const std::vector<const Material*>* m_Materials;
+		const std::vector<Material>* m_Materials;
 		const std::vector<Light>* m_Lights;
 		uint32_t m_NrOfPixels;
-		float m_FieldOfVieuw;
+		mutable float m_FieldOfVieuw;
 		float m_AscpectRatio;
-		std::vector<uint32_t> m_Pixelindices;
+		uint32_t m_TileSize;
+		std::vector<Tile> m_Tiles;
+		mutable std::atomic<uint32_t> m_NextTile;
+		mutable std::vector<Tile> m_DirtyTiles;
+		mutable float m_RenderedTileFraction;
+		mutable std::atomic<uint64_t> m_RayCount;
+		mutable std::vector<uint32_t> m_PixelCosts;
+		mutable std::vector<DirectionBlock> m_CameraSpaceDirections;	// Normalized, only depend on the resolution and the field of view
+		mutable std::vector<DirectionBlock> m_CameraRayDirections;		// The table above rotated to world space, redone only when the camera turns
+		mutable float m_DirectionTableFovAngle;
+		mutable Vector3 m_DirectionTableAxes[3];						// Camera right, up and forward the world space table was rotated with
+		mutable std::vector<HitRecord> m_WavefrontHits;				// Per pixel, reused by every wavefront frame
+		mutable std::vector<ShadowRayKey> m_ShadowRayStream;
+		mutable std::vector<ShadowRayKey> m_ShadowRayScratch;
+		mutable std::vector<uint8_t> m_ShadowOcclusion;				// Per pixel and light, 1 when the shadow ray towards the light was blocked
+		mutable ThreadPool m_ThreadPool;
+		mutable FrameState m_RenderedFrame;
 
 		float LambertsCosineLaw(const Vector3& normalSurface, const Vector3& incomingLight, float incomingLightMagnitude) const;
-		void RenderPixel(uint32_t pixelIndex) const;
+		void CreateTiles();
+		bool IsUpscaling() const { return m_Framebuffer.width != m_OutputFramebuffer.width || m_Framebuffer.height != m_OutputFramebuffer.height; }
+		void UpscaleFramebuffer() const;
+		FrameState GetFrameState() const;
+		// RenderTile instantiation for the lighting mode and shadow setting of the frame, picked once per Render call
+		using TileRenderer = void (Renderer::*)(const Tile& tile) const;
+
+		// RenderWavefront instantiation for the lighting mode and shadow setting of the frame
+		using FrameRenderer = void (Renderer::*)() const;
+
+		TileRenderer SelectTileRenderer() const;
+		FrameRenderer SelectWavefrontRenderer() const;
+		void DispatchTiles(TileRenderer renderTile, const std::vector<Tile>& tiles) const;
+		void RenderTiles(TileRenderer renderTile, const std::vector<Tile>& tiles) const;
+		// Fills m_DirtyTiles when the only difference with the last frame is what the scene marked as moved, false when every tile has to be redrawn
+		bool CollectDirtyTiles() const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderTile(const Tile& tile) const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderTileSorted(const Tile& tile) const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderTilePackets(const Tile& tile) const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderWavefront() const;
+		void TraceTileWavefront(const Tile& tile) const;
+		void TraceShadowRayStream(const Light& light, uint32_t lightIndex, const Vector3& minOrigin, const Vector3& maxOrigin, uint32_t hitCount) const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		uint32_t RenderPixel(uint32_t px, uint32_t py) const;
+		void UpdateCameraRayDirections() const;
+		Vector3 GetCameraRayDirection(uint32_t px, uint32_t py) const { return GetCameraRayDirection(px + (py * m_Width)); }
+		Vector3 GetCameraRayDirection(uint32_t pixelIndex) const;
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		ColorRGB ShadeHit(const HitRecord& closestHit, const Vector3& cameraRayDirection, uint32_t& rayCount) const;
+		// Shading with shadow rays that were already traced, lightOcclusion holds one entry per light
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		ColorRGB ShadeHit(const HitRecord& closestHit, const Vector3& cameraRayDirection, const uint8_t* lightOcclusion) const;
+		template<LightingMode lightingMode>
+		void ShadeLight(ColorRGB& color, const HitRecord& closestHit, const Vector3& cameraRayDirection, const Light& light, const Vector3& lightRayDirection,
+			const Ray& lightRay, bool isShadowed) const;
+		void WritePixel(uint32_t pixelIndex, ColorRGB color) const;
+		void DrawCostHeatmap() const;
 	};
 }
@@ -0,0 +1,226 @@
+#pragma once
+
+// External includes
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+	#define SIMD_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SIMD_SSE
+	#include <emmintrin.h>
+#endif
+
+// 4-wide path for Vector4 and the rows of a Matrix, SSE comes with every x64 target and NEON with every ARM64 one
+#if defined(SIMD_AVX2) || defined(SIMD_SSE)
+	#define SIMD4_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define SIMD4_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace dae
+{
+	/**
+	 * \brief 8 floats processed as one, backed by a single AVX register, a pair of SSE registers or a plain array
+	 * Comparisons return masks with every bit of a passing lane set, so they can be combined with & and | and fed to Select
+	 */
+	struct Float8
+	{
+		static constexpr uint32_t Width{ 8 };
+
+#if defined(SIMD_AVX2)
+		__m256 value;
+
+		static Float8 Load(const float* pData) { return { _mm256_load_ps(pData) }; }
+		static void Store(float* pData, const Float8& a) { _mm256_store_ps(pData, a.value); }
+		static Float8 Broadcast(float value) { return { _mm256_set1_ps(value) }; }
+		static Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return { _mm256_blendv_ps(b.value, a.value, mask.value) }; }
+		static Float8 Min(const Float8& a, const Float8& b) { return { _mm256_min_ps(a.value, b.value) }; }
+		static Float8 Max(const Float8& a, const Float8& b) { return { _mm256_max_ps(a.value, b.value) }; }
+
+		// Flips the sign of every lane of a where the matching lane of sign is negative
+		static Float8 MultiplySign(const Float8& a, const Float8& sign) { return { _mm256_xor_ps(a.value, _mm256_and_ps(sign.value, _mm256_set1_ps(-0.0f))) }; }
+		static Float8 Abs(const Float8& a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.value) }; }
+		static Float8 Sqrt(const Float8& a) { return { _mm256_sqrt_ps(a.value) }; }
+
+		// One bit per lane, set when the lane of the mask passed
+		static uint32_t MoveMask(const Float8& mask) { return uint32_t(_mm256_movemask_ps(mask.value)); }
+
+		static float HorizontalMin(const Float8& a)
+		{
+			__m128 minimum{ _mm_min_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1)) };
+			minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+			minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(minimum);
+		}
+
+		static float HorizontalMax(const Float8& a)
+		{
+			__m128 maximum{ _mm_max_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1)) };
+			maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+			maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(maximum);
+		}
+
+		friend Float8 operator+(const Float8& a, const Float8& b) { return { _mm256_add_ps(a.value, b.value) }; }
+		friend Float8 operator-(const Float8& a, const Float8& b) { return { _mm256_sub_ps(a.value, b.value) }; }
+		friend Float8 operator*(const Float8& a, const Float8& b) { return { _mm256_mul_ps(a.value, b.value) }; }
+		friend Float8 operator/(const Float8& a, const Float8& b) { return { _mm256_div_ps(a.value, b.value) }; }
+		friend Float8 operator&(const Float8& a, const Float8& b) { return { _mm256_and_ps(a.value, b.value) }; }
+		friend Float8 operator|(const Float8& a, const Float8& b) { return { _mm256_or_ps(a.value, b.value) }; }
+		friend Float8 operator<(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ) }; }
+		friend Float8 operator<=(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ) }; }
+		friend Float8 operator>(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ) }; }
+		friend Float8 operator>=(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GE_OQ) }; }
+		friend Float8 operator==(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ) }; }
+		friend Float8 operator!=(const Float8& a, const Float8& b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_NEQ_UQ) }; }
+
+#elif defined(SIMD_SSE)
+		__m128 low;
+		__m128 high;
+
+		static Float8 Load(const float* pData) { return { _mm_load_ps(pData), _mm_load_ps(pData + 4) }; }
+		static void Store(float* pData, const Float8& a) { _mm_store_ps(pData, a.low); _mm_store_ps(pData + 4, a.high); }
+		static Float8 Broadcast(float value) { const __m128 v{ _mm_set1_ps(value) }; return { v, v }; }
+		static Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+		{
+			return { _mm_or_ps(_mm_and_ps(mask.low, a.low), _mm_andnot_ps(mask.low, b.low)), _mm_or_ps(_mm_and_ps(mask.high, a.high), _mm_andnot_ps(mask.high, b.high)) };
+		}
+		static Float8 Min(const Float8& a, const Float8& b) { return { _mm_min_ps(a.low, b.low), _mm_min_ps(a.high, b.high) }; }
+		static Float8 Max(const Float8& a, const Float8& b) { return { _mm_max_ps(a.low, b.low), _mm_max_ps(a.high, b.high) }; }
+
+		static Float8 MultiplySign(const Float8& a, const Float8& sign)
+		{
+			const __m128 signBit{ _mm_set1_ps(-0.0f) };
+			return { _mm_xor_ps(a.low, _mm_and_ps(sign.low, signBit)), _mm_xor_ps(a.high, _mm_and_ps(sign.high, signBit)) };
+		}
+		static Float8 Abs(const Float8& a)
+		{
+			const __m128 signBit{ _mm_set1_ps(-0.0f) };
+			return { _mm_andnot_ps(signBit, a.low), _mm_andnot_ps(signBit, a.high) };
+		}
+		static Float8 Sqrt(const Float8& a) { return { _mm_sqrt_ps(a.low), _mm_sqrt_ps(a.high) }; }
+
+		static uint32_t MoveMask(const Float8& mask) { return uint32_t(_mm_movemask_ps(mask.low) | (_mm_movemask_ps(mask.high) << 4)); }
+
+		static float HorizontalMin(const Float8& a)
+		{
+			__m128 minimum{ _mm_min_ps(a.low, a.high) };
+			minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+			minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(minimum);
+		}
+
+		static float HorizontalMax(const Float8& a)
+		{
+			__m128 maximum{ _mm_max_ps(a.low, a.high) };
+			maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+			maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(maximum);
+		}
+
+		friend Float8 operator+(const Float8& a, const Float8& b) { return { _mm_add_ps(a.low, b.low), _mm_add_ps(a.high, b.high) }; }
+		friend Float8 operator-(const Float8& a, const Float8& b) { return { _mm_sub_ps(a.low, b.low), _mm_sub_ps(a.high, b.high) }; }
+		friend Float8 operator*(const Float8& a, const Float8& b) { return { _mm_mul_ps(a.low, b.low), _mm_mul_ps(a.high, b.high) }; }
+		friend Float8 operator/(const Float8& a, const Float8& b) { return { _mm_div_ps(a.low, b.low), _mm_div_ps(a.high, b.high) }; }
+		friend Float8 operator&(const Float8& a, const Float8& b) { return { _mm_and_ps(a.low, b.low), _mm_and_ps(a.high, b.high) }; }
+		friend Float8 operator|(const Float8& a, const Float8& b) { return { _mm_or_ps(a.low, b.low), _mm_or_ps(a.high, b.high) }; }
+		friend Float8 operator<(const Float8& a, const Float8& b) { return { _mm_cmplt_ps(a.low, b.low), _mm_cmplt_ps(a.high, b.high) }; }
+		friend Float8 operator<=(const Float8& a, const Float8& b) { return { _mm_cmple_ps(a.low, b.low), _mm_cmple_ps(a.high, b.high) }; }
+		friend Float8 operator>(const Float8& a, const Float8& b) { return { _mm_cmpgt_ps(a.low, b.low), _mm_cmpgt_ps(a.high, b.high) }; }
+		friend Float8 operator>=(const Float8& a, const Float8& b) { return { _mm_cmpge_ps(a.low, b.low), _mm_cmpge_ps(a.high, b.high) }; }
+		friend Float8 operator==(const Float8& a, const Float8& b) { return { _mm_cmpeq_ps(a.low, b.low), _mm_cmpeq_ps(a.high, b.high) }; }
+		friend Float8 operator!=(const Float8& a, const Float8& b) { return { _mm_cmpneq_ps(a.low, b.low), _mm_cmpneq_ps(a.high, b.high) }; }
+
+#else
+		// Scalar fallback, masks are stored as 0.0f / 1.0f instead of bit patterns
+		float lanes[Width];
+
+		template<typename Operation>
+		static Float8 PerLane(Operation operation)
+		{
+			Float8 result{};
+			for (uint32_t lane{}; lane < Width; ++lane) result.lanes[lane] = operation(lane);
+			return result;
+		}
+
+		static Float8 Load(const float* pData) { return PerLane([&](uint32_t lane) { return pData[lane]; }); }
+		static void Store(float* pData, const Float8& a) { std::copy(a.lanes, a.lanes + Width, pData); }
+		static Float8 Broadcast(float value) { return PerLane([&](uint32_t) { return value; }); }
+		static Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return mask.lanes[lane] != 0.0f ? a.lanes[lane] : b.lanes[lane]; }); }
+		static Float8 Min(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return std::min(a.lanes[lane], b.lanes[lane]); }); }
+		static Float8 Max(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return std::max(a.lanes[lane], b.lanes[lane]); }); }
+		static Float8 MultiplySign(const Float8& a, const Float8& sign) { return PerLane([&](uint32_t lane) { return sign.lanes[lane] < 0.0f ? -a.lanes[lane] : a.lanes[lane]; }); }
+		static Float8 Abs(const Float8& a) { return PerLane([&](uint32_t lane) { return a.lanes[lane] < 0.0f ? -a.lanes[lane] : a.lanes[lane]; }); }
+		static Float8 Sqrt(const Float8& a) { return PerLane([&](uint32_t lane) { return std::sqrt(a.lanes[lane]); }); }
+
+		static uint32_t MoveMask(const Float8& mask)
+		{
+			uint32_t bits{};
+			for (uint32_t lane{}; lane < Width; ++lane) bits |= (mask.lanes[lane] != 0.0f ? 1u : 0u) << lane;
+			return bits;
+		}
+
+		static float HorizontalMin(const Float8& a) { return *std::min_element(a.lanes, a.lanes + Width); }
+		static float HorizontalMax(const Float8& a) { return *std::max_element(a.lanes, a.lanes + Width); }
+
+		friend Float8 operator+(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] + b.lanes[lane]; }); }
+		friend Float8 operator-(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] - b.lanes[lane]; }); }
+		friend Float8 operator*(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] * b.lanes[lane]; }); }
+		friend Float8 operator/(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] / b.lanes[lane]; }); }
+		friend Float8 operator&(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return (a.lanes[lane] != 0.0f && b.lanes[lane] != 0.0f) ? 1.0f : 0.0f; }); }
+		friend Float8 operator|(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return (a.lanes[lane] != 0.0f || b.lanes[lane] != 0.0f) ? 1.0f : 0.0f; }); }
+		friend Float8 operator<(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] < b.lanes[lane] ? 1.0f : 0.0f; }); }
+		friend Float8 operator<=(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] <= b.lanes[lane] ? 1.0f : 0.0f; }); }
+		friend Float8 operator>(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] > b.lanes[lane] ? 1.0f : 0.0f; }); }
+		friend Float8 operator>=(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] >= b.lanes[lane] ? 1.0f : 0.0f; }); }
+		friend Float8 operator==(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] == b.lanes[lane] ? 1.0f : 0.0f; }); }
+		friend Float8 operator!=(const Float8& a, const Float8& b) { return PerLane([&](uint32_t lane) { return a.lanes[lane] != b.lanes[lane] ? 1.0f : 0.0f; }); }
+#endif
+	};
+
+	/**
+	 * \brief 4 floats processed as one, backed by an SSE or NEON register or a plain array
+	 * Loads and stores are unaligned, so it can be pointed at any Vector4 or Matrix row
+	 */
+	struct Float4
+	{
+#if defined(SIMD4_SSE)
+		__m128 value;
+
+		static Float4 Load(const float* pData) { return { _mm_loadu_ps(pData) }; }
+		static void Store(float* pData, const Float4& a) { _mm_storeu_ps(pData, a.value); }
+		static Float4 Broadcast(float value) { return { _mm_set1_ps(value) }; }
+
+		friend Float4 operator+(const Float4& a, const Float4& b) { return { _mm_add_ps(a.value, b.value) }; }
+		friend Float4 operator-(const Float4& a, const Float4& b) { return { _mm_sub_ps(a.value, b.value) }; }
+		friend Float4 operator*(const Float4& a, const Float4& b) { return { _mm_mul_ps(a.value, b.value) }; }
+
+#elif defined(SIMD4_NEON)
+		float32x4_t value;
+
+		static Float4 Load(const float* pData) { return { vld1q_f32(pData) }; }
+		static void Store(float* pData, const Float4& a) { vst1q_f32(pData, a.value); }
+		static Float4 Broadcast(float value) { return { vdupq_n_f32(value) }; }
+
+		friend Float4 operator+(const Float4& a, const Float4& b) { return { vaddq_f32(a.value, b.value) }; }
+		friend Float4 operator-(const Float4& a, const Float4& b) { return { vsubq_f32(a.value, b.value) }; }
+		friend Float4 operator*(const Float4& a, const Float4& b) { return { vmulq_f32(a.value, b.value) }; }
+
+#else
+		float lanes[4];
+
+		static Float4 Load(const float* pData) { return { { pData[0], pData[1], pData[2], pData[3] } }; }
+		static void Store(float* pData, const Float4& a) { std::copy(a.lanes, a.lanes + 4, pData); }
+		static Float4 Broadcast(float value) { return { { value, value, value, value } }; }
+
+		friend Float4 operator+(const Float4& a, const Float4& b) { return { { a.lanes[0] + b.lanes[0], a.lanes[1] + b.lanes[1], a.lanes[2] + b.lanes[2], a.lanes[3] + b.lanes[3] } }; }
+		friend Float4 operator-(const Float4& a, const Float4& b) { return { { a.lanes[0] - b.lanes[0], a.lanes[1] - b.lanes[1], a.lanes[2] - b.lanes[2], a.lanes[3] - b.lanes[3] } }; }
+		friend Float4 operator*(const Float4& a, const Float4& b) { return { { a.lanes[0] * b.lanes[0], a.lanes[1] * b.lanes[1], a.lanes[2] * b.lanes[2], a.lanes[3] * b.lanes[3] } }; }
+#endif
+	};
+}
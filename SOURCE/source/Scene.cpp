@@ -1,6 +1,7 @@
 #include "Scene.h"
 #include "Utils.h"
-#include "Material.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 
 namespace dae
 {
@@ -11,7 +12,15 @@ namespace dae
 		m_Planes{},
 		m_Spheres{},
 		m_Triangles{},
-		m_TriangleMeshes{}
+		m_TriangleMeshes{},
+		m_MeshInstances{},
+		m_pThreadPool{ nullptr },
+		m_Version{ 0 },
+		m_BoundedPrimitives{},
+		m_TopLevelBVH{},
+		m_ChangedBounds{},
+		m_ChangedBoundsVersion{ 0 },
+		m_ChangesBounded{ true }
 	{
 		m_Lights.reserve(32);
 		m_Materials.reserve(32);
@@ -19,81 +28,290 @@ namespace dae
 		m_Spheres.reserve(32);
 		m_Triangles.reserve(32);
 		m_TriangleMeshes.reserve(32);
+		m_MeshInstances.reserve(32);
 
-		m_Materials.emplace_back(new Material_SolidColor{ ColorRGB{1.0f, 0.0f, 0.0f} });
-	}
-
-	Scene::~Scene()
-	{
-		for (const Material* pMaterial : m_Materials)
-		{
-			delete pMaterial;
-		}
-
-		m_Materials.clear();
+		m_Materials.emplace_back(Material_SolidColor{ ColorRGB{1.0f, 0.0f, 0.0f} });
 	}
 
 	void Scene::Update(Timer* pTimer)
 	{
+		// Changes are collected per Update, they only describe the step from the scene as the previous Update left it
+		m_ChangedBounds.clear();
+		m_ChangedBoundsVersion = m_Version;
+		m_ChangesBounded = true;
+
 		m_Camera.Update(pTimer);
 	}
 
-	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	void Scene::UpdateTopLevelBVH()
 	{
-		HitRecord hitRecord{};
+		PROFILE_ZONE("Scene::UpdateTopLevelBVH");
+
+		m_BoundedPrimitives.clear();
+		m_BoundedPrimitives.reserve(m_Spheres.size() + m_Triangles.size() + m_TriangleMeshes.size() + m_MeshInstances.size());
+
+		std::vector<Vector3> minBounds{};
+		std::vector<Vector3> maxBounds{};
+		minBounds.reserve(m_BoundedPrimitives.capacity());
+		maxBounds.reserve(m_BoundedPrimitives.capacity());
 
-		for (const Sphere& sphere : m_Spheres)
+		for (uint32_t index{}; index < m_Spheres.size(); ++index)
 		{
-			dae::GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord);
+			const Sphere& sphere{ m_Spheres[index] };
+			const Vector3 radius{ sphere.radius, sphere.radius, sphere.radius };
 
-			if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+			m_BoundedPrimitives.emplace_back(PrimitiveReference{ PrimitiveType::Sphere, index });
+			minBounds.emplace_back(sphere.origin - radius);
+			maxBounds.emplace_back(sphere.origin + radius);
 		}
 
-		for (const Plane& plane : m_Planes)
+		for (uint32_t index{}; index < m_Triangles.size(); ++index)
 		{
-			dae::GeometryUtils::HitTest_Plane(plane, ray, hitRecord);
+			const Triangle& triangle{ m_Triangles[index] };
 
-			if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+			m_BoundedPrimitives.emplace_back(PrimitiveReference{ PrimitiveType::Triangle, index });
+			minBounds.emplace_back(Vector3::Min(triangle.v0, Vector3::Min(triangle.v1, triangle.v2)));
+			maxBounds.emplace_back(Vector3::Max(triangle.v0, Vector3::Max(triangle.v1, triangle.v2)));
 		}
 
-		for (const Triangle& triangle : m_Triangles)
+		for (uint32_t index{}; index < m_TriangleMeshes.size(); ++index)
 		{
-			dae::GeometryUtils::HitTest_Triangle(triangle, ray, hitRecord);
+			const TriangleMesh& mesh{ m_TriangleMeshes[index] };
+			if (mesh.bvh.nodes.empty()) continue;
 
-			if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+			// The root of the mesh BVH is tighter than the transformed object space AABB
+			m_BoundedPrimitives.emplace_back(PrimitiveReference{ PrimitiveType::TriangleMesh, index });
+			minBounds.emplace_back(mesh.bvh.nodes[0].minAABB);
+			maxBounds.emplace_back(mesh.bvh.nodes[0].maxAABB);
 		}
 
-		for (const TriangleMesh& mesh : m_TriangleMeshes)
+		for (uint32_t index{}; index < m_MeshInstances.size(); ++index)
 		{
-			dae::GeometryUtils::HitTest_TriangleMesh(mesh, ray, hitRecord);
+			const MeshInstance& instance{ m_MeshInstances[index] };
+			if (!instance.pMesh || instance.pMesh->bvh.nodes.empty()) continue;
 
-			if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+			m_BoundedPrimitives.emplace_back(PrimitiveReference{ PrimitiveType::MeshInstance, index });
+			minBounds.emplace_back(instance.minAABB);
+			maxBounds.emplace_back(instance.maxAABB);
 		}
+
+		m_TopLevelBVH.Build(minBounds, maxBounds);
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
-		for (const Sphere& sphere : m_Spheres)
+		STATS_INCREMENT(PrimaryRays);
+
+		// Every hit shortens the ray, so the top level traversal can skip whatever lies behind it
+		Ray closestRay{ ray };
+		HitRecord hitRecord{};
+
+		for (const Plane& plane : m_Planes)
 		{
-			if (dae::GeometryUtils::HitTest_Sphere(sphere, ray)) return true;
+			if (dae::GeometryUtils::HitTest_Plane(plane, closestRay, hitRecord) && hitRecord.t < closestHit.t)
+			{
+				closestHit = hitRecord;
+				closestRay.max = hitRecord.t;
+			}
 		}
 
-		for (const Plane& plane : m_Planes)
+		dae::GeometryUtils::TraverseBVH_ClosestHit(m_TopLevelBVH, closestRay,
+			[&](uint32_t primitiveIndex, Ray& currentRay)
+			{
+				const PrimitiveReference& primitive{ m_BoundedPrimitives[primitiveIndex] };
+				bool didHit{ false };
+
+				switch (primitive.type)
+				{
+					case PrimitiveType::Sphere:
+						didHit = dae::GeometryUtils::HitTest_Sphere(m_Spheres[primitive.index], currentRay, hitRecord);
+						break;
+					case PrimitiveType::Triangle:
+						didHit = dae::GeometryUtils::HitTest_Triangle(m_Triangles[primitive.index], currentRay, hitRecord);
+						break;
+					case PrimitiveType::TriangleMesh:
+						didHit = dae::GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshes[primitive.index], currentRay, hitRecord);
+						break;
+					case PrimitiveType::MeshInstance:
+						didHit = dae::GeometryUtils::HitTest_MeshInstance(m_MeshInstances[primitive.index], currentRay, hitRecord);
+						break;
+				}
+
+				if (didHit && hitRecord.t < closestHit.t)
+				{
+					closestHit = hitRecord;
+					currentRay.max = hitRecord.t;
+				}
+			}
+		);
+
+		if (closestHit.didHit) STATS_INCREMENT(PrimaryHits);
+	}
+
+	void Scene::GetClosestHit(const RayPacket& rayPacket, HitRecord* closestHits) const
+	{
+		STATS_ADD(PrimaryRays, std::popcount(rayPacket.activeMask));
+
+		// Planes are tested outside the top level BVH, so a lane hit indexes either m_Planes or m_BoundedPrimitives
+		enum class LaneHitType : uint32_t
+		{
+			Plane,
+			BoundedPrimitive
+		};
+
+		// Only the closest primitive of every lane is remembered, its HitRecord is filled in once the packet is done
+		struct LaneHit
 		{
-			if (dae::GeometryUtils::HitTest_Plane(plane, ray)) return true;
+			LaneHitType type;
+			uint32_t index;
+			uint32_t triangleIndex;
+		};
+
+		dae::GeometryUtils::PacketRays packet{ dae::GeometryUtils::LoadRayPacket(rayPacket) };
+		LaneHit laneHits[RayPacket::Width]{};
+		uint32_t triangleIndices[RayPacket::Width]{};
+		uint32_t hitLanes{};
+
+		const auto recordHits{ [&](uint32_t lanes, LaneHitType type, uint32_t index)
+			{
+				hitLanes |= lanes;
+				while (lanes != 0)
+				{
+					const int lane{ std::countr_zero(lanes) };
+					laneHits[lane] = LaneHit{ type, index, triangleIndices[lane] };
+					lanes &= lanes - 1;
+				}
+			}
+		};
+
+		for (uint32_t index{}; index < m_Planes.size(); ++index)
+		{
+			recordHits(dae::GeometryUtils::HitTest_Plane(m_Planes[index], packet), LaneHitType::Plane, index);
 		}
 
-		for (const Triangle& triangle : m_Triangles)
+		dae::GeometryUtils::TraverseBVH_ClosestHit(m_TopLevelBVH, packet,
+			[&](uint32_t primitiveIndex, dae::GeometryUtils::PacketRays& currentPacket)
+			{
+				const PrimitiveReference& primitive{ m_BoundedPrimitives[primitiveIndex] };
+				uint32_t lanes{};
+
+				switch (primitive.type)
+				{
+					case PrimitiveType::Sphere:
+						lanes = dae::GeometryUtils::HitTest_Sphere(m_Spheres[primitive.index], currentPacket);
+						break;
+					case PrimitiveType::Triangle:
+						lanes = dae::GeometryUtils::HitTest_Triangle(m_Triangles[primitive.index], currentPacket);
+						break;
+					case PrimitiveType::TriangleMesh:
+						lanes = dae::GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshes[primitive.index], currentPacket, triangleIndices);
+						break;
+					case PrimitiveType::MeshInstance:
+						lanes = dae::GeometryUtils::HitTest_MeshInstance(m_MeshInstances[primitive.index], currentPacket, triangleIndices);
+						break;
+				}
+
+				recordHits(lanes, LaneHitType::BoundedPrimitive, primitiveIndex);
+			}
+		);
+
+		alignas(32) float distances[RayPacket::Width];
+		Float8::Store(distances, packet.max);
+		hitLanes &= rayPacket.activeMask;
+
+		for (uint32_t lane{}; lane < RayPacket::Width; ++lane)
 		{
-			if (dae::GeometryUtils::HitTest_Triangle(triangle, ray)) return true;
+			HitRecord& closestHit{ closestHits[lane] };
+			closestHit = HitRecord{};
+			if ((hitLanes & (1u << lane)) == 0) continue;
+
+			const Vector3 direction{ rayPacket.directionX[lane], rayPacket.directionY[lane], rayPacket.directionZ[lane] };
+			const float t{ distances[lane] };
+			const LaneHit& hit{ laneHits[lane] };
+
+			closestHit.origin = rayPacket.origin + (direction * t);
+			closestHit.t = t;
+			closestHit.didHit = true;
+
+			if (hit.type == LaneHitType::Plane)
+			{
+				closestHit.normal = m_Planes[hit.index].normal;
+				closestHit.materialIndex = m_Planes[hit.index].materialIndex;
+				continue;
+			}
+
+			const PrimitiveReference& primitive{ m_BoundedPrimitives[hit.index] };
+			switch (primitive.type)
+			{
+				case PrimitiveType::Sphere:
+				{
+					const Sphere& sphere{ m_Spheres[primitive.index] };
+					closestHit.normal = (closestHit.origin - sphere.origin) / sphere.radius;
+					closestHit.materialIndex = sphere.materialIndex;
+					break;
+				}
+				case PrimitiveType::Triangle:
+					closestHit.normal = m_Triangles[primitive.index].normal;
+					closestHit.materialIndex = m_Triangles[primitive.index].materialIndex;
+					break;
+				case PrimitiveType::TriangleMesh:
+					closestHit.normal = m_TriangleMeshes[primitive.index].transformedNormals[hit.triangleIndex];
+					closestHit.materialIndex = m_TriangleMeshes[primitive.index].materialIndex;
+					break;
+				case PrimitiveType::MeshInstance:
+				{
+					// Same inverse transpose as HitTest_MeshInstance
+					const MeshInstance& instance{ m_MeshInstances[primitive.index] };
+					const Vector3 objectNormal{ instance.pMesh->normals[hit.triangleIndex] };
+
+					closestHit.normal = Vector3{ Vector3::Dot(objectNormal, instance.worldToObject[0]),
+						Vector3::Dot(objectNormal, instance.worldToObject[1]),
+						Vector3::Dot(objectNormal, instance.worldToObject[2]) }.Normalized();
+					closestHit.materialIndex = instance.materialIndex;
+					break;
+				}
+			}
 		}
 
-		for (const TriangleMesh& mesh : m_TriangleMeshes)
+		STATS_ADD(PrimaryHits, std::popcount(hitLanes));
+	}
+
+	bool Scene::IsOccluded(const Ray& shadowRay) const
+	{
+		STATS_INCREMENT(ShadowRays);
+
+		for (const Plane& plane : m_Planes)
 		{
-			if (dae::GeometryUtils::HitTest_TriangleMesh(mesh, ray)) return true;
+			if (dae::GeometryUtils::HitTest_Plane(plane, shadowRay))
+			{
+				STATS_INCREMENT(ShadowHits);
+				return true;
+			}
 		}
 
-		return false;
+		const bool isOccluded{ dae::GeometryUtils::TraverseBVH_AnyHit(m_TopLevelBVH, shadowRay,
+			[&](uint32_t primitiveIndex)
+			{
+				const PrimitiveReference& primitive{ m_BoundedPrimitives[primitiveIndex] };
+
+				switch (primitive.type)
+				{
+					case PrimitiveType::Sphere:
+						return dae::GeometryUtils::HitTest_Sphere(m_Spheres[primitive.index], shadowRay);
+					case PrimitiveType::Triangle:
+						return dae::GeometryUtils::HitTest_Triangle(m_Triangles[primitive.index], shadowRay);
+					case PrimitiveType::TriangleMesh:
+						return dae::GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshes[primitive.index], shadowRay);
+					case PrimitiveType::MeshInstance:
+						return dae::GeometryUtils::HitTest_MeshInstance(m_MeshInstances[primitive.index], shadowRay);
+				}
+
+				return false;
+			}
+		) };
+
+		if (isOccluded) STATS_INCREMENT(ShadowHits);
+		return isOccluded;
 	}
 
 	Camera& Scene::GetCamera()
@@ -106,11 +324,65 @@ namespace dae
 		return m_Lights;
 	}
 
-	const std::vector<const Material*>& Scene::GetMaterials() const
+	const std::vector<Material>& Scene::GetMaterials() const
 	{ 
 		return m_Materials;
 	}
 
+	const std::vector<Plane>& Scene::GetPlanes() const
+	{
+		return m_Planes;
+	}
+
+	const std::vector<Sphere>& Scene::GetSpheres() const
+	{
+		return m_Spheres;
+	}
+
+	const std::vector<Triangle>& Scene::GetTriangles() const
+	{
+		return m_Triangles;
+	}
+
+	const std::vector<TriangleMesh>& Scene::GetTriangleMeshes() const
+	{
+		return m_TriangleMeshes;
+	}
+
+	const std::vector<MeshInstance>& Scene::GetMeshInstances() const
+	{
+		return m_MeshInstances;
+	}
+
+	bool Scene::GetBounds(Vector3& minBounds, Vector3& maxBounds) const
+	{
+		if (m_TopLevelBVH.nodes.empty()) return false;
+
+		minBounds = m_TopLevelBVH.nodes[0].minAABB;
+		maxBounds = m_TopLevelBVH.nodes[0].maxAABB;
+		return true;
+	}
+
+	void Scene::SetThreadPool(ThreadPool* pThreadPool)
+	{
+		m_pThreadPool = pThreadPool;
+	}
+
+	void Scene::MarkChanged(const Vector3& minBounds, const Vector3& maxBounds)
+	{
+		m_ChangedBounds.emplace_back(ChangedBounds{ minBounds, maxBounds });
+		++m_Version;
+	}
+
+	void Scene::MarkSphereMoved(const Sphere& previous, const Sphere& current)
+	{
+		const Vector3 previousRadius{ previous.radius, previous.radius, previous.radius };
+		const Vector3 currentRadius{ current.radius, current.radius, current.radius };
+
+		MarkChanged(previous.origin - previousRadius, previous.origin + previousRadius);
+		MarkChanged(current.origin - currentRadius, current.origin + currentRadius);
+	}
+
 	void Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		m_Lights.emplace_back(Light{ origin, Vector3::Zero, color, intensity, LightType::Point });
@@ -121,7 +393,7 @@ namespace dae
 		m_Lights.emplace_back(Light{ Vector3::Zero, direction, color, intensity, LightType::Directional });
 	}
 
-	unsigned char Scene::AddMaterial(Material* material)
+	unsigned char Scene::AddMaterial(const Material& material)
 	{
 		m_Materials.emplace_back(material);
 		return static_cast<unsigned char>(m_Materials.size() - 1);
@@ -146,14 +418,19 @@ namespace dae
 		m_TriangleMeshes.emplace_back(m);
 	}
 
+	void Scene::AddMeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, unsigned char materialIndex)
+	{
+		m_MeshInstances.emplace_back(MeshInstance{ pMesh, materialIndex });
+	}
+
 	void Scene_W1::Initialize()
 	{
 		// Materials
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue{ AddMaterial(new Material_SolidColor{ colors::Blue }) };
-		const unsigned char matId_Solid_Yellow{ AddMaterial(new Material_SolidColor{ colors::Yellow }) };
-		const unsigned char matId_Solid_Green{ AddMaterial(new Material_SolidColor{ colors::Green }) };
-		const unsigned char matId_Solid_Magenta{ AddMaterial(new Material_SolidColor{ colors::Magenta }) };
+		const unsigned char matId_Solid_Blue{ AddMaterial(Material_SolidColor{ colors::Blue }) };
+		const unsigned char matId_Solid_Yellow{ AddMaterial(Material_SolidColor{ colors::Yellow }) };
+		const unsigned char matId_Solid_Green{ AddMaterial(Material_SolidColor{ colors::Green }) };
+		const unsigned char matId_Solid_Magenta{ AddMaterial(Material_SolidColor{ colors::Magenta }) };
 
 		//Spheres
 		AddSphere(Vector3{ -25.0f, 0.0f, 100.0f }, 50.0f, matId_Solid_Red);
@@ -175,10 +452,10 @@ namespace dae
 
 		// Material id's
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue{ AddMaterial(new Material_SolidColor{ colors::Blue }) };
-		const unsigned char matId_Solid_Yellow{ AddMaterial(new Material_SolidColor{ colors::Yellow }) };
-		const unsigned char matId_Solid_Green{ AddMaterial(new Material_SolidColor{ colors::Green }) };
-		const unsigned char matId_Solid_Magenta{ AddMaterial(new Material_SolidColor{ colors::Magenta }) };
+		const unsigned char matId_Solid_Blue{ AddMaterial(Material_SolidColor{ colors::Blue }) };
+		const unsigned char matId_Solid_Yellow{ AddMaterial(Material_SolidColor{ colors::Yellow }) };
+		const unsigned char matId_Solid_Green{ AddMaterial(Material_SolidColor{ colors::Green }) };
+		const unsigned char matId_Solid_Magenta{ AddMaterial(Material_SolidColor{ colors::Magenta }) };
 
 		// Planes
 		AddPlane(Vector3{ -5.0f, 0.0f, 0.0f }, Vector3{ 1.0f, 0.0f, 0.0f }, matId_Solid_Green);
@@ -204,13 +481,13 @@ namespace dae
 		m_Camera.origin = Vector3{ 0.0f, 3.0f, -9.0f };
 		m_Camera.fovAngle = 45.0f;
 
-		const unsigned char matCT_GrayRoughMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f }) };
-		const unsigned char matCT_GrayMediumMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
-		const unsigned char matCT_GraySmoothMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
-		const unsigned char matCT_GrayRoughPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 1.0f }) };
-		const unsigned char matCT_GrayMediumPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f }) };
-		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
-		const unsigned char matLambert_GrayBlue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
+		const unsigned char matCT_GrayRoughMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f }) };
+		const unsigned char matCT_GrayMediumMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
+		const unsigned char matCT_GraySmoothMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
+		const unsigned char matCT_GrayRoughPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 1.0f }) };
+		const unsigned char matCT_GrayMediumPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f }) };
+		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
+		const unsigned char matLambert_GrayBlue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
 
 		//Plane
 		AddPlane(Vector3{ 0.0f, 0.0f, 10.0f }, Vector3{ 0.0f, 0.0f, -1.0f }, matLambert_GrayBlue);; //Back
@@ -220,9 +497,9 @@ namespace dae
 		AddPlane(Vector3{ -5.0f, 0.0f, 0.0f }, Vector3{ 1.0f, 0.0f, 0.0f }, matLambert_GrayBlue);; //Left
 
 		// Todo 7
-		/*const auto matLambertPhong1{ AddMaterial(new Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 3.0f }) };
-		const auto matLambertPhong2{ AddMaterial(new Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 15.0f }) };
-		const auto matLambertPhong3{ AddMaterial(new Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 50.0f }) };
+		/*const auto matLambertPhong1{ AddMaterial(Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 3.0f }) };
+		const auto matLambertPhong2{ AddMaterial(Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 15.0f }) };
+		const auto matLambertPhong3{ AddMaterial(Material_LambertPhong{ colors::Blue, 0.5f, 0.5f, 50.0f }) };
 		AddSphere(Vector3{ -1.75, 1.0f, 0.0f }, 0.75f, matLambertPhong1);
 		AddSphere(Vector3{ 0.0f, 1.0f, 0.0f }, 0.75f, matLambertPhong2);
 		AddSphere(Vector3{ 1.75, 1.0f, 0.0f }, 0.75f, matLambertPhong3);*/
@@ -247,8 +524,8 @@ namespace dae
 		m_Camera.fovAngle = 45.f;
 
 		//Materials
-		const unsigned char matLambert_GrayBlue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
-		const unsigned char matLambert_White{ AddMaterial(new Material_Lambert{ colors::White, 1.0f }) };
+		const unsigned char matLambert_GrayBlue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
+		const unsigned char matLambert_White{ AddMaterial(Material_Lambert{ colors::White, 1.0f }) };
 
 		//Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -280,7 +557,7 @@ namespace dae
 		m_TriangleMeshes[0].CalculateNormals();
 		m_TriangleMeshes[0].UpdateAABB();
 		m_TriangleMeshes[0].Translate({ 0.f,1.5f,0.f });
-		m_TriangleMeshes[0].UpdateTransforms();
+		m_TriangleMeshes[0].UpdateTransforms(m_pThreadPool);
 
 		//Light
 		AddPointLight(Vector3{ 0.0f, 5.0f, 5.0f }, 50.0f, ColorRGB{ 1.0f, 0.61f, 0.45f }); //Backlight
@@ -295,8 +572,10 @@ namespace dae
 		for (TriangleMesh& mesh : m_TriangleMeshes)
 		{
 			mesh.RotateY(PI_DIV_2 * pTimer->GetTotal());
-			mesh.UpdateTransforms();
+			mesh.UpdateTransforms(m_pThreadPool);
 		}
+
+		MarkChanged();
 	}
 
 	void Scene_W4_ReferenceScene::Initialize()
@@ -304,14 +583,14 @@ namespace dae
 		m_Camera.origin = Vector3{ 0.0f, 3.0f, -9.0f };
 		m_Camera.fovAngle = 45.0f;
 
-		const unsigned char matCT_GrayRoughMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f }) };
-		const unsigned char matCT_GrayMediumMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
-		const unsigned char matCT_GraySmoothMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
-		const unsigned char matCT_GrayRoughPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 1.0f }) };
-		const unsigned char matCT_GrayMediumPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f }) };
-		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
-		const unsigned char matLambert_GrayBlue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
-		const unsigned char matLambert_White{ AddMaterial(new Material_Lambert{ colors::White, 1.0f }) };
+		const unsigned char matCT_GrayRoughMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f }) };
+		const unsigned char matCT_GrayMediumMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
+		const unsigned char matCT_GraySmoothMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
+		const unsigned char matCT_GrayRoughPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 1.0f }) };
+		const unsigned char matCT_GrayMediumPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f }) };
+		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
+		const unsigned char matLambert_GrayBlue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
+		const unsigned char matLambert_White{ AddMaterial(Material_Lambert{ colors::White, 1.0f }) };
 
 		AddPlane(Vector3{ 0.0f, 0.0f, 10.0f }, Vector3{ 0.0f, 0.0f, -1.0f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.0f, 0.0f, 0.0f }, Vector3{ 0.0f, 1.0f, 0.0f }, matLambert_GrayBlue); //BOTTOM
@@ -333,19 +612,19 @@ namespace dae
 		m_TriangleMeshes[0].AppendTriangle(baseTriangle, true);
 		m_TriangleMeshes[0].UpdateAABB();
 		m_TriangleMeshes[0].Translate({ -1.75f,4.5f,0.f });
-		m_TriangleMeshes[0].UpdateTransforms();
+		m_TriangleMeshes[0].UpdateTransforms(m_pThreadPool);
 
 		AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_TriangleMeshes[1].AppendTriangle(baseTriangle, true);
 		m_TriangleMeshes[1].UpdateAABB();
 		m_TriangleMeshes[1].Translate({ 0.f,4.5f,0.f });
-		m_TriangleMeshes[1].UpdateTransforms();
+		m_TriangleMeshes[1].UpdateTransforms(m_pThreadPool);
 
 		AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
 		m_TriangleMeshes[2].AppendTriangle(baseTriangle, true);
 		m_TriangleMeshes[2].UpdateAABB();
 		m_TriangleMeshes[2].Translate({ 1.75f,4.5f,0.f });
-		m_TriangleMeshes[2].UpdateTransforms();
+		m_TriangleMeshes[2].UpdateTransforms(m_pThreadPool);
 
 		AddPointLight(Vector3{ 0.0f, 5.0f, 5.0f }, 50.0f, ColorRGB{ 1.0f, 0.61f, 0.45f }); //Backlight
 		AddPointLight(Vector3{ -2.5f, 5.0f, -5.0f }, 70.0f, ColorRGB{ 1.0f, 0.8f, 0.45f }); //Front Light Left
@@ -359,8 +638,10 @@ namespace dae
 		for (TriangleMesh& mesh : m_TriangleMeshes)
 		{
 			mesh.RotateY(PI_DIV_2 * pTimer->GetTotal());
-			mesh.UpdateTransforms();
+			mesh.UpdateTransforms(m_pThreadPool);
 		}
+
+		MarkChanged();
 	}
 
 	void Scene_W4_BunnyScene::Initialize()
@@ -369,8 +650,8 @@ namespace dae
 		m_Camera.fovAngle = 45.0f;
 
 		// Materials
-		const unsigned char matLambert_GrayBlue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
-		const unsigned char matLambert_White{ AddMaterial(new Material_Lambert{ colors::White, 1.0f }) };
+		const unsigned char matLambert_GrayBlue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
+		const unsigned char matLambert_White{ AddMaterial(Material_Lambert{ colors::White, 1.0f }) };
 
 		// Planes
 		AddPlane(Vector3{ 0.0f, 0.0f, 10.0f }, Vector3{ 0.0f, 0.0f, -1.0f }, matLambert_GrayBlue); //BACK
@@ -379,12 +660,15 @@ namespace dae
 		AddPlane(Vector3{ 5.0f, 0.0f, 0.0f }, Vector3{ -1.0f, 0.0f, 0.0f }, matLambert_GrayBlue); //RIGHT
 		AddPlane(Vector3{ -5.0f, 0.0f, 0.0f }, Vector3{ 1.0f, 0.0f, 0.0f }, matLambert_GrayBlue); //LEFT
 
-		// Mesh
-		AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/bunny.obj", m_TriangleMeshes[0].positions, m_TriangleMeshes[0].normals, m_TriangleMeshes[0].indices);
-		m_TriangleMeshes[0].Scale(Vector3{ 1.5f, 1.5f, 1.5f });
-		m_TriangleMeshes[0].UpdateAABB();
-		m_TriangleMeshes[0].UpdateTransforms();
+		// Mesh, instanced so animating it only updates a matrix
+		std::shared_ptr<TriangleMesh> pBunny{ std::make_shared<TriangleMesh>() };
+		pBunny->cullMode = TriangleCullMode::BackFaceCulling;
+		Utils::ParseOBJ("Resources/bunny.obj", pBunny->positions, pBunny->normals, pBunny->indices, m_pThreadPool);
+		pBunny->PrepareForInstancing();
+
+		AddMeshInstance(pBunny, matLambert_White);
+		m_MeshInstances[0].Scale(Vector3{ 1.5f, 1.5f, 1.5f });
+		m_MeshInstances[0].UpdateTransforms();
 
 		// Lights
 		AddPointLight(Vector3{ 0.0f, 5.0f, 5.0f }, 50.0f, ColorRGB{ 1.0f, 0.61f, 0.45f }); //Backlight
@@ -396,11 +680,13 @@ namespace dae
 	{
 		Scene::Update(pTimer);
 
-		for (TriangleMesh& mesh : m_TriangleMeshes)
+		for (MeshInstance& instance : m_MeshInstances)
 		{
-			mesh.RotateY(PI_DIV_2 * pTimer->GetTotal());
-			mesh.UpdateTransforms();
+			instance.RotateY(PI_DIV_2 * pTimer->GetTotal());
+			instance.UpdateTransforms();
 		}
+
+		MarkChanged();
 	}
 
 	void Scene_W4_ExtraScene::Initialize()
@@ -409,16 +695,16 @@ namespace dae
 		m_Camera.fovAngle = 45.0f;
 
 		// Materials
-		const unsigned char matCT_GrayMediumMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
-		const unsigned char matCT_GraySmoothMetal{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
-		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(new Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
-
-		const unsigned char matLambert_GrayBlue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
-		const unsigned char matLambert_Red{ AddMaterial(new Material_Lambert{ ColorRGB{ 1.0f, 0.0f, 0.0f }, 1.0f }) };
-		const unsigned char matLambert_Green{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.0f, 1.0f, 0.0f }, 1.0f }) };
-		const unsigned char matLambert_Blue{ AddMaterial(new Material_Lambert{ ColorRGB{ 0.0f, 0.0f, 1.0f }, 1.0f }) };
-		const unsigned char matLambert_Phong{ AddMaterial(new Material_LambertPhong{ ColorRGB{ 1.0f, 1.0f, 1.0f }, 0.7f, 0.8f, 0.7f }) };
-		const unsigned char matLambert_Phong2{ AddMaterial(new Material_LambertPhong{ ColorRGB{ 1.0f, 1.0f, 1.0f }, 0.3f, 0.2f, 0.3f }) };
+		const unsigned char matCT_GrayMediumMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f }) };
+		const unsigned char matCT_GraySmoothMetal{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f }) };
+		const unsigned char matCT_GraySmoothPlastic{ AddMaterial(Material_CookTorrence{ ColorRGB{ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f }) };
+
+		const unsigned char matLambert_GrayBlue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.0f }) };
+		const unsigned char matLambert_Red{ AddMaterial(Material_Lambert{ ColorRGB{ 1.0f, 0.0f, 0.0f }, 1.0f }) };
+		const unsigned char matLambert_Green{ AddMaterial(Material_Lambert{ ColorRGB{ 0.0f, 1.0f, 0.0f }, 1.0f }) };
+		const unsigned char matLambert_Blue{ AddMaterial(Material_Lambert{ ColorRGB{ 0.0f, 0.0f, 1.0f }, 1.0f }) };
+		const unsigned char matLambert_Phong{ AddMaterial(Material_LambertPhong{ ColorRGB{ 1.0f, 1.0f, 1.0f }, 0.7f, 0.8f, 0.7f }) };
+		const unsigned char matLambert_Phong2{ AddMaterial(Material_LambertPhong{ ColorRGB{ 1.0f, 1.0f, 1.0f }, 0.3f, 0.2f, 0.3f }) };
 		
 
 		// Planes
@@ -441,6 +727,7 @@ namespace dae
 	void Scene_W4_ExtraScene::Update(Timer* pTimer)
 	{
 		Scene::Update(pTimer);
+		const Sphere previousSpheres[]{ m_Spheres[0], m_Spheres[1] };
 
 		// First sphere which changes radius
 		float sine{ sinf(pTimer->GetTotal()) };
@@ -452,5 +739,28 @@ namespace dae
 		const float x{ m_Spheres[0].origin.x + (radius * cosf(pTimer->GetTotal())) };
 		const float y{ m_Spheres[0].origin.y + (radius * sinf(pTimer->GetTotal())) };
 		m_Spheres[1].origin = Vector3{ x, y, m_Spheres[0].origin.z };
+
+		// Only the two spheres changed, so a renderer can keep every tile that they and their shadows do not reach
+		MarkSphereMoved(previousSpheres[0], m_Spheres[0]);
+		MarkSphereMoved(previousSpheres[1], m_Spheres[1]);
+	}
+
+	std::unique_ptr<Scene> CreateScene(const std::string& name)
+	{
+		if (name == "W1") return std::make_unique<Scene_W1>();
+		if (name == "W2") return std::make_unique<Scene_W2>();
+		if (name == "W3") return std::make_unique<Scene_W3>();
+		if (name == "W4_TestScene") return std::make_unique<Scene_W4_TestScene>();
+		if (name == "W4_ReferenceScene") return std::make_unique<Scene_W4_ReferenceScene>();
+		if (name == "W4_BunnyScene") return std::make_unique<Scene_W4_BunnyScene>();
+		if (name == "W4_ExtraScene") return std::make_unique<Scene_W4_ExtraScene>();
+
+		return nullptr;
+	}
+
+	const std::vector<std::string>& GetSceneNames()
+	{
+		static const std::vector<std::string> sceneNames{ "W1", "W2", "W3", "W4_TestScene", "W4_ReferenceScene", "W4_BunnyScene", "W4_ExtraScene" };
+		return sceneNames;
 	}
 }
\ No newline at end of file
@@ -1,20 +1,23 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <string>
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "Material.h"
 
 namespace dae
 {
 	// Forward Declerations
 	class Timer;
-	class Material;
+	class ThreadPool;
 
 	class Scene
 	{
 		public:
 			Scene();
-			virtual ~Scene();
+			virtual ~Scene() = default;
 
 			Scene(const Scene&) = delete;
 			Scene(Scene&&) noexcept = delete;
@@ -23,30 +26,101 @@ namespace dae
 
 			virtual void Initialize() = 0;
 			virtual void Update(Timer* pTimer);
+			void UpdateTopLevelBVH();
+			/**
+			 * \brief Pool used to spread mesh loading and transform updates over threads, set before Initialize
+			 * Without one everything runs on the calling thread
+			 */
+			void SetThreadPool(ThreadPool* pThreadPool);
 			void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
-			bool DoesHit(const Ray& ray) const;
+			/**
+			 * \brief GetClosestHit for the 8 rays of a packet at once, with one SIMD lane per ray
+			 * Writes a HitRecord per lane, the ones of inactive lanes are left as misses
+			 */
+			void GetClosestHit(const RayPacket& rayPacket, HitRecord* closestHits) const;
+			/**
+			 * \brief Shadow ray query, stops at the first primitive found between ray.min and ray.max
+			 * Nothing is written to a HitRecord, so no hit position, normal or material gets computed
+			 */
+			bool IsOccluded(const Ray& shadowRay) const;
 			Camera& GetCamera();
 			const std::vector<Light>& GetLights() const;
-			const std::vector<const Material*>& GetMaterials() const;
+			const std::vector<Material>& GetMaterials() const;
+			const std::vector<Plane>& GetPlanes() const;
+			const std::vector<Sphere>& GetSpheres() const;
+			const std::vector<Triangle>& GetTriangles() const;
+			const std::vector<TriangleMesh>& GetTriangleMeshes() const;
+			const std::vector<MeshInstance>& GetMeshInstances() const;
+			/**
+			 * \brief Box around every sphere, triangle and mesh as of the last UpdateTopLevelBVH, false when there are none
+			 * Together with the planes it holds every surface a ray can hit
+			 */
+			bool GetBounds(Vector3& minBounds, Vector3& maxBounds) const;
+			/**
+			 * \brief Bumped by every Update that moved, resized or animated a primitive, the camera keeps its own version
+			 * Scenes without animation never change it, so a renderer can keep showing its last frame while the camera is still too
+			 */
+			uint64_t GetVersion() const { return m_Version; }
+
+			// World space box of something an Update moved, given once for where it was and once for where it ended up
+			struct ChangedBounds
+			{
+				Vector3 minBounds;
+				Vector3 maxBounds;
+			};
+
+			/**
+			 * \brief Boxes around everything the last Update moved, relative to the scene as it was at GetChangedBoundsVersion
+			 * Only complete while AreChangesBounded, an Update that changed the scene without giving bounds leaves all of it changed
+			 */
+			const std::vector<ChangedBounds>& GetChangedBounds() const { return m_ChangedBounds; }
+			uint64_t GetChangedBoundsVersion() const { return m_ChangedBoundsVersion; }
+			bool AreChangesBounded() const { return m_ChangesBounded; }
 
 		protected:
 			Camera m_Camera;
 			std::vector<Light> m_Lights;
-			std::vector<const Material*> m_Materials;
+			std::vector<Material> m_Materials;
 			std::vector<Plane> m_Planes;
 			std::vector<Sphere> m_Spheres;
 			std::vector<Triangle> m_Triangles;
 			std::vector<TriangleMesh> m_TriangleMeshes;
+			std::vector<MeshInstance> m_MeshInstances;
+			ThreadPool* m_pThreadPool;
+			uint64_t m_Version;
 
+			void MarkChanged() { ++m_Version; m_ChangesBounded = false; }
+			void MarkChanged(const Vector3& minBounds, const Vector3& maxBounds);
+			void MarkSphereMoved(const Sphere& previous, const Sphere& current);
 			void AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 			void AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-			unsigned char AddMaterial(Material* material);
+			unsigned char AddMaterial(const Material& material);
 			void AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 			void AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 			void AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+			void AddMeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, unsigned char materialIndex = 0);
 
 		private:
-			
+			enum class PrimitiveType : uint32_t
+			{
+				Sphere,
+				Triangle,
+				TriangleMesh,
+				MeshInstance
+			};
+
+			// Bounded primitive stored in the top level BVH, planes are unbounded and tested separately
+			struct PrimitiveReference
+			{
+				PrimitiveType type;
+				uint32_t index;
+			};
+
+			std::vector<PrimitiveReference> m_BoundedPrimitives;
+			BVH m_TopLevelBVH;
+			std::vector<ChangedBounds> m_ChangedBounds;
+			uint64_t m_ChangedBoundsVersion;
+			bool m_ChangesBounded;
 	};
 
 	class Scene_W1 final : public Scene
@@ -170,4 +244,10 @@ namespace dae
 	private:
 
 	};
+
+	/**
+	 * \brief Creates the Scene_* class with the given name, without the Scene_ prefix, or nullptr when there is none
+	 */
+	std::unique_ptr<Scene> CreateScene(const std::string& name);
+	const std::vector<std::string>& GetSceneNames();
 }
@@ -0,0 +1,195 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+#endif
+
+namespace dae
+{
+	ThreadPool::ThreadPool(uint32_t threadCount, bool pinThreads) :
+		m_Workers{},
+		m_Queues{},
+		m_SleepMutex{},
+		m_WakeUp{},
+		m_QueuedTasks{ 0 },
+		m_IsStopping{ false },
+		m_PinThreads{ false }
+	{
+		Start(threadCount, pinThreads);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		Stop();
+	}
+
+	void ThreadPool::Resize(uint32_t threadCount, bool pinThreads)
+	{
+		Stop();
+		Start(threadCount, pinThreads);
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, const RangeJob& job, uint32_t grainSize)
+	{
+		if (count == 0) return;
+
+		grainSize = std::max(1u, grainSize);
+		const uint32_t taskCount{ (count + grainSize - 1) / grainSize };
+
+		if (m_Workers.empty() || taskCount == 1)
+		{
+			job(0, count);
+			return;
+		}
+
+		// Every queue gets a contiguous run of tasks, so threads start out on neighbouring work and only steal once their own run is done
+		std::atomic<uint32_t> remaining{ taskCount };
+		const uint32_t queueCount{ uint32_t(m_Queues.size()) };
+
+		for (uint32_t queueIndex{}; queueIndex < queueCount; ++queueIndex)
+		{
+			const uint32_t firstTask{ uint32_t(uint64_t(taskCount) * queueIndex / queueCount) };
+			const uint32_t lastTask{ uint32_t(uint64_t(taskCount) * (queueIndex + 1) / queueCount) };
+			TaskQueue& queue{ *m_Queues[queueIndex] };
+			const std::lock_guard<std::mutex> lock{ queue.mutex };
+
+			for (uint32_t taskIndex{ firstTask }; taskIndex < lastTask; ++taskIndex)
+			{
+				queue.tasks.emplace_back(Task{ &job, taskIndex * grainSize, std::min(count, (taskIndex + 1) * grainSize), &remaining });
+			}
+		}
+
+		m_QueuedTasks.fetch_add(taskCount);
+		{
+			const std::lock_guard<std::mutex> lock{ m_SleepMutex };
+		}
+		m_WakeUp.notify_all();
+
+		Task task{};
+		while (remaining.load(std::memory_order_acquire) > 0)
+		{
+			if (PopTask(0, task)) Execute(task);
+			else std::this_thread::yield();
+		}
+	}
+
+	void ThreadPool::Start(uint32_t threadCount, bool pinThreads)
+	{
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		m_IsStopping = false;
+		m_PinThreads = pinThreads;
+
+		m_Queues.reserve(threadCount);
+		for (uint32_t queueIndex{}; queueIndex < threadCount; ++queueIndex)
+		{
+			m_Queues.emplace_back(std::make_unique<TaskQueue>());
+		}
+
+		const uint32_t coreCount{ std::max(1u, std::thread::hardware_concurrency()) };
+		m_Workers.reserve(threadCount - 1);
+
+		for (uint32_t queueIndex{ 1 }; queueIndex < threadCount; ++queueIndex)
+		{
+			m_Workers.emplace_back([this, queueIndex]() { WorkerLoop(queueIndex); });
+			if (pinThreads) PinToCore(m_Workers.back(), queueIndex % coreCount);
+		}
+	}
+
+	void ThreadPool::Stop()
+	{
+		{
+			const std::lock_guard<std::mutex> lock{ m_SleepMutex };
+			m_IsStopping = true;
+		}
+		m_WakeUp.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		m_Workers.clear();
+		m_Queues.clear();
+		m_QueuedTasks = 0;
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t queueIndex)
+	{
+		Task task{};
+
+		while (true)
+		{
+			if (PopTask(queueIndex, task))
+			{
+				Execute(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ m_SleepMutex };
+			m_WakeUp.wait(lock, [this]() { return m_IsStopping || m_QueuedTasks.load() > 0; });
+			if (m_IsStopping) return;
+		}
+	}
+
+	bool ThreadPool::PopTask(uint32_t queueIndex, Task& task)
+	{
+		// Own tasks come off the front, in the order they were handed out
+		{
+			TaskQueue& queue{ *m_Queues[queueIndex] };
+			const std::lock_guard<std::mutex> lock{ queue.mutex };
+
+			if (!queue.tasks.empty())
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				m_QueuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+
+		// Stolen tasks come off the back, furthest away from what the owner is working on
+		const uint32_t queueCount{ uint32_t(m_Queues.size()) };
+		for (uint32_t offset{ 1 }; offset < queueCount; ++offset)
+		{
+			TaskQueue& victim{ *m_Queues[(queueIndex + offset) % queueCount] };
+			const std::lock_guard<std::mutex> lock{ victim.mutex };
+
+			if (!victim.tasks.empty())
+			{
+				task = victim.tasks.back();
+				victim.tasks.pop_back();
+				m_QueuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::Execute(const Task& task)
+	{
+		(*task.pJob)(task.begin, task.end);
+		task.pRemaining->fetch_sub(1, std::memory_order_release);
+	}
+
+	void ThreadPool::PinToCore(std::thread& thread, uint32_t core)
+	{
+		#if defined(_WIN32)
+			SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+		#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(core, &cpuSet);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+		#else
+			(void)thread;
+			(void)core;
+		#endif
+	}
+}
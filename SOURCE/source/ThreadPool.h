@@ -0,0 +1,87 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Persistent pool of worker threads, every worker owns a task queue and steals from the others once its own runs dry
+	 * The thread that calls ParallelFor works along, so a pool of N threads starts N - 1 workers
+	 */
+	class ThreadPool final
+	{
+	public:
+		using RangeJob = std::function<void(uint32_t begin, uint32_t end)>;
+
+		explicit ThreadPool(uint32_t threadCount = 0, bool pinThreads = false);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Restarts the workers, a thread count of 0 uses every hardware thread
+		 * Pinned workers are each bound to their own core, the calling thread is left alone
+		 */
+		void Resize(uint32_t threadCount, bool pinThreads);
+
+		/**
+		 * \brief Calls job over [0, count) in ranges of grainSize and returns once all of them are done
+		 * Only the thread that owns the pool may call this, jobs must not call it again themselves
+		 */
+		void ParallelFor(uint32_t count, const RangeJob& job, uint32_t grainSize = 1);
+
+		uint32_t GetThreadCount() const { return uint32_t(m_Workers.size()) + 1; }
+		bool ArePinned() const { return m_PinThreads; }
+
+	private:
+		struct Task
+		{
+			const RangeJob* pJob;
+			uint32_t begin;
+			uint32_t end;
+			std::atomic<uint32_t>* pRemaining;
+		};
+
+		struct TaskQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::thread> m_Workers;
+		std::vector<std::unique_ptr<TaskQueue>> m_Queues;	// Queue 0 belongs to the calling thread, queue i to worker i - 1
+		std::mutex m_SleepMutex;
+		std::condition_variable m_WakeUp;
+		std::atomic<uint32_t> m_QueuedTasks;
+		bool m_IsStopping;
+		bool m_PinThreads;
+
+		void Start(uint32_t threadCount, bool pinThreads);
+		void Stop();
+		void WorkerLoop(uint32_t queueIndex);
+		bool PopTask(uint32_t queueIndex, Task& task);
+		static void Execute(const Task& task);
+		static void PinToCore(std::thread& thread, uint32_t core);
+	};
+
+	/**
+	 * \brief Runs job over [0, count) on the pool, or straight on the calling thread when there is no pool
+	 */
+	inline void ParallelFor(ThreadPool* pThreadPool, uint32_t count, const ThreadPool::RangeJob& job, uint32_t grainSize = 1)
+	{
+		if (pThreadPool) pThreadPool->ParallelFor(count, job, grainSize);
+		else if (count > 0) job(0, count);
+	}
+}
@@ -6,18 +6,30 @@
 #include <iostream>
 #include <fstream>
 
-#include "SDL.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
 using namespace dae;
 
+namespace
+{
+	// Nanoseconds on a monotonic clock, so the timer works without SDL on headless machines
+	uint64_t GetPerformanceCounter()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
 Timer::Timer()
 {
-	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
+	const uint64_t countsPerSecond = 1'000'000'000;
 	m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
 }
 
 void Timer::Reset()
 {
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 
 	m_BaseTime = currentTime;
 	m_PreviousTime = currentTime;
@@ -29,7 +41,7 @@ void Timer::Reset()
 
 void Timer::Start()
 {
-	const uint64_t startTime = SDL_GetPerformanceCounter();
+	const uint64_t startTime = GetPerformanceCounter();
 
 	if (m_IsStopped)
 	{
@@ -64,6 +76,41 @@ void Timer::StartBenchmark(int numFrames)
 	std::cout << "**BENCHMARK STARTED**\n";
 }
 
+void Timer::SetTargetFrameTime(float seconds)
+{
+	m_TargetFrameTime = std::max(0.0f, seconds);
+	m_ResolutionScale = 1.0f;
+	m_FullResolutionFrameTime = 0.0f;
+}
+
+void Timer::ToggleDynamicResolution()
+{
+	SetTargetFrameTime(IsDynamicResolutionEnabled() ? 0.0f : m_DefaultTargetFrameTime);
+	std::cout << "Dynamic resolution: " << (IsDynamicResolutionEnabled() ? "on" : "off");
+	if (IsDynamicResolutionEnabled()) std::cout << " (target " << m_TargetFrameTime * 1000.0f << " ms)";
+	std::cout << std::endl;
+}
+
+void Timer::UpdateResolutionScale(float frameTime)
+{
+	if (!IsDynamicResolutionEnabled() || frameTime <= 0.0f)
+		return;
+
+	// Smoothed so a single slow frame does not drop the resolution, the first frame seeds the estimate
+	const float fullResolutionFrameTime{ frameTime / (m_ResolutionScale * m_ResolutionScale) };
+	m_FullResolutionFrameTime = (m_FullResolutionFrameTime > 0.0f) ? m_FullResolutionFrameTime + (fullResolutionFrameTime - m_FullResolutionFrameTime) * m_FrameTimeSmoothing
+		: fullResolutionFrameTime;
+
+	// Work that does not scale with the pixels just raises the estimate at low scales, so the loop still settles on the target
+	const float idealScale{ std::clamp(std::sqrt(m_TargetFrameTime / m_FullResolutionFrameTime), m_MinResolutionScale, 1.0f) };
+
+	// The dead band keeps the renderer from resizing, and rebuilding its per pixel tables, for every small wobble in frame time
+	if (std::abs(idealScale - m_ResolutionScale) > m_ResolutionScaleDeadBand || idealScale == 1.0f || idealScale == m_MinResolutionScale)
+	{
+		m_ResolutionScale = idealScale;
+	}
+}
+
 void Timer::Update()
 {
 	if (m_IsStopped)
@@ -74,12 +121,18 @@ void Timer::Update()
 		return;
 	}
 
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
 	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
 	m_PreviousTime = m_CurrentTime;
 
+	if (m_FixedTimeStep > 0.0f)
+	{
+		m_ElapsedTime = m_FixedTimeStep;
+		m_FixedTotalTime += m_FixedTimeStep;
+	}
+
 	if (m_ElapsedTime < 0.0f)
 		m_ElapsedTime = 0.0f;
 
@@ -88,7 +141,7 @@ void Timer::Update()
 		m_ElapsedTime = m_ElapsedUpperBound;
 	}
 
-	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
+	m_TotalTime = (m_FixedTimeStep > 0.0f) ? m_FixedTotalTime : (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
 
 	//FPS LOGIC
 	m_FPSTimer += m_ElapsedTime;
@@ -135,7 +188,7 @@ void Timer::Stop()
 {
 	if (!m_IsStopped)
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_StopTime = currentTime;
 		m_IsStopped = true;
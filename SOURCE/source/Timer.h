@@ -24,11 +24,33 @@ namespace dae
 		void Update();
 		void Stop();
 
+		/**
+		 * \brief Advances the timer by exactly this many seconds every Update instead of by wall clock time, 0 goes back to the clock
+		 * Makes animated scenes render the same frames on every run
+		 */
+		void SetFixedTimeStep(float seconds) { m_FixedTimeStep = seconds; m_FixedTotalTime = 0.0f; };
+
+		/**
+		 * \brief Dynamic resolution: the resolution scale is picked after every rendered frame so frames take this long, 0 turns it off and goes back to full resolution
+		 */
+		void SetTargetFrameTime(float seconds);
+		void ToggleDynamicResolution();
+		/**
+		 * \brief Feeds the controller the time a frame took at the current resolution scale
+		 * Render time is taken as proportional to the pixel count, so every frame gives an estimate of the full resolution frame time and the scale follows the square root of the target over that estimate
+		 */
+		void UpdateResolutionScale(float frameTime);
+		bool IsDynamicResolutionEnabled() const { return m_TargetFrameTime > 0.0f; };
+		float GetTargetFrameTime() const { return m_TargetFrameTime; };
+		float GetResolutionScale() const { return m_ResolutionScale; };
+		float GetFullResolutionFrameTime() const { return m_FullResolutionFrameTime; };	// Smoothed estimate the scale is picked from, 0 before the first frame
+
 		uint32_t GetFPS() const { return m_FPS; };
 		float GetdFPS() const { return m_dFPS; };
 		float GetElapsed() const { return m_ElapsedTime; };
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
+		bool IsBenchmarkActive() const { return m_BenchmarkActive; };
 
 	private:
 		uint64_t m_BaseTime = 0;
@@ -46,6 +68,8 @@ namespace dae
 		float m_SecondsPerCount = 0.0f;
 		float m_ElapsedUpperBound = 0.03f;
 		float m_FPSTimer = 0.0f;
+		float m_FixedTimeStep = 0.0f;
+		float m_FixedTotalTime = 0.0f;
 
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
@@ -57,5 +81,13 @@ namespace dae
 		int m_BenchmarkFrames{ 0 };
 		int m_BenchmarkCurrFrame{ 0 };
 		std::vector<float> m_Benchmarks{};
+
+		float m_TargetFrameTime{ 0.0f };
+		float m_DefaultTargetFrameTime{ 1.0f / 60.0f };
+		float m_ResolutionScale{ 1.0f };
+		float m_MinResolutionScale{ 0.25f };
+		float m_ResolutionScaleDeadBand{ 0.02f };
+		float m_FullResolutionFrameTime{ 0.0f };
+		float m_FrameTimeSmoothing{ 0.2f };
 	};
 }
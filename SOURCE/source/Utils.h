@@ -1,8 +1,17 @@
 #pragma once
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <string_view>
+#include <bit>
 #include "Math.h"
 #include "DataTypes.h"
+#include "SIMD.h"
+#include "ThreadPool.h"
+#include "RenderStats.h"
 
 namespace dae
 {
@@ -10,9 +19,10 @@ namespace dae
 	{
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord)
 		{
+			STATS_INCREMENT(SphereTests);
 			const float A = Vector3::Dot(ray.direction, ray.direction);
 			const float B = Vector3::Dot(2 * ray.direction, ray.origin - sphere.origin);
-			const float C = Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - std::powf(sphere.radius, 2);
+			const float C = Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - powf(sphere.radius, 2);
 
 			const float discriminant{ powf(B, 2) - 4 * A * C };
 
@@ -30,6 +40,7 @@ namespace dae
 
 				if (t >= ray.min && t <= ray.max)
 				{
+					STATS_INCREMENT(SphereHits);
 					hitRecord.origin = ray.origin + (t * ray.direction);
 					hitRecord.normal = (hitRecord.origin - sphere.origin) / sphere.radius;
 					hitRecord.t = t;
@@ -45,9 +56,10 @@ namespace dae
 
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
 		{
+			STATS_INCREMENT(SphereTests);
 			const float A = Vector3::Dot(ray.direction, ray.direction);
 			const float B = Vector3::Dot(2 * ray.direction, ray.origin - sphere.origin);
-			const float C = Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - std::powf(sphere.radius, 2.0f);
+			const float C = Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - powf(sphere.radius, 2.0f);
 
 			const float discriminant{ powf(B, 2.0f) - 4 * A * C };
 
@@ -65,6 +77,7 @@ namespace dae
 
 				if (t >= ray.min && t <= ray.max)
 				{
+					STATS_INCREMENT(SphereHits);
 					return true;
 				}
 			}
@@ -74,10 +87,12 @@ namespace dae
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord)
 		{
+			STATS_INCREMENT(PlaneTests);
 			const float t = (Vector3::Dot((plane.origin - ray.origin), plane.normal)) / (Vector3::Dot(ray.direction, plane.normal));
 
 			if (t >= ray.min && t <= ray.max)
 			{
+				STATS_INCREMENT(PlaneHits);
 				hitRecord.origin = ray.origin + (t * ray.direction);
 				hitRecord.normal = plane.normal;
 				hitRecord.t = t;
@@ -92,9 +107,14 @@ namespace dae
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
+			STATS_INCREMENT(PlaneTests);
 			const float t = (Vector3::Dot((plane.origin - ray.origin), plane.normal)) / (Vector3::Dot(ray.direction, plane.normal));
 
-			if (t >= ray.min && t <= ray.max) return true;
+			if (t >= ray.min && t <= ray.max)
+			{
+				STATS_INCREMENT(PlaneHits);
+				return true;
+			}
 
 			return false;
 		}
@@ -122,45 +142,162 @@ namespace dae
 			return (tmax > 0) && (tmax >= tmin);
 		}
 
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
+		/**
+		 * \brief Möller–Trumbore ray/triangle test on a triangle stored as a vertex and its two edges
+		 * The barycentric coordinates are compared unscaled and inclusively, which closes most gaps on shared edges but is not watertight:
+		 * each triangle rounds its own edge products, so a ray exactly through a shared edge can still miss both triangles
+		 * \param cullMode Faces of this orientation are skipped, the front face being the one the triangle normal points out of
+		 * \return Distance along the ray to the hit, FLT_MAX when the triangle is missed within [ray.min, ray.max]
+		 */
+		inline float IntersectTriangle(const Vector3& v0, const Vector3& edge1, const Vector3& edge2, TriangleCullMode cullMode, const Ray& ray)
+		{
+			STATS_INCREMENT(TriangleTests);
+			const Vector3 p{ Vector3::Cross(ray.direction, edge2) };
+
+			// The determinant is -dot(normal, direction), positive when the ray looks at the front face
+			float determinant{ Vector3::Dot(edge1, p) };
+
+			switch (cullMode)
+			{
+				case TriangleCullMode::NoCulling:
+					if (determinant == 0.0f) return FLT_MAX;
+					break;
+				case TriangleCullMode::FrontFaceCulling:
+					if (determinant >= 0.0f) return FLT_MAX;
+					break;
+				case TriangleCullMode::BackFaceCulling:
+					if (determinant <= 0.0f) return FLT_MAX;
+					break;
+			}
+
+			const Vector3 s{ ray.origin - v0 };
+			const Vector3 q{ Vector3::Cross(s, edge1) };
+
+			float u{ Vector3::Dot(s, p) };
+			float v{ Vector3::Dot(ray.direction, q) };
+			float tScaled{ Vector3::Dot(edge2, q) };
+
+			if (determinant < 0.0f)
+			{
+				determinant = -determinant;
+				u = -u;
+				v = -v;
+				tScaled = -tScaled;
+			}
+
+			if (u < 0.0f || v < 0.0f || u + v > determinant) return FLT_MAX;
+			if (tScaled < ray.min * determinant || tScaled > ray.max * determinant) return FLT_MAX;
+
+			STATS_INCREMENT(TriangleHits);
+			return tScaled / determinant;
+		}
+
+		inline float IntersectTriangle(const PrecomputedTriangle& triangle, TriangleCullMode cullMode, const Ray& ray)
 		{
-			const Vector3 a{ triangle.v1 - triangle.v0 };
-			const Vector3 b{ triangle.v2 - triangle.v0 };
-			const Vector3 n{ Vector3::Cross(a, b).Normalized() };
+			return IntersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, cullMode, ray);
+		}
 
-			switch (triangle.cullMode)
+		// Ray origin and direction in every lane, so they are broadcast once per mesh instead of once per block
+		struct BlockRay
+		{
+			Float8 originX;
+			Float8 originY;
+			Float8 originZ;
+			Float8 directionX;
+			Float8 directionY;
+			Float8 directionZ;
+		};
+
+		inline BlockRay BroadcastRay(const Ray& ray)
+		{
+			return BlockRay{ Float8::Broadcast(ray.origin.x), Float8::Broadcast(ray.origin.y), Float8::Broadcast(ray.origin.z),
+				Float8::Broadcast(ray.direction.x), Float8::Broadcast(ray.direction.y), Float8::Broadcast(ray.direction.z) };
+		}
+
+		/**
+		 * \brief IntersectTriangle on the 8 triangles of a block at once
+		 * \return Distance to the hit per lane, FLT_MAX in the lanes that missed within [ray.min, ray.max]
+		 */
+		inline Float8 IntersectTriangleBlockLanes(const TriangleBlock& block, TriangleCullMode cullMode, const BlockRay& blockRay, const Ray& ray)
+		{
+			const Float8 edge1x{ Float8::Load(block.edge1x) };
+			const Float8 edge1y{ Float8::Load(block.edge1y) };
+			const Float8 edge1z{ Float8::Load(block.edge1z) };
+			const Float8 edge2x{ Float8::Load(block.edge2x) };
+			const Float8 edge2y{ Float8::Load(block.edge2y) };
+			const Float8 edge2z{ Float8::Load(block.edge2z) };
+
+			// p = direction x edge2
+			const Float8 px{ blockRay.directionY * edge2z - blockRay.directionZ * edge2y };
+			const Float8 py{ blockRay.directionZ * edge2x - blockRay.directionX * edge2z };
+			const Float8 pz{ blockRay.directionX * edge2y - blockRay.directionY * edge2x };
+
+			const Float8 determinant{ edge1x * px + edge1y * py + edge1z * pz };
+			const Float8 zero{ Float8::Broadcast(0.0f) };
+
+			Float8 hitMask{};
+			switch (cullMode)
 			{
 				case TriangleCullMode::NoCulling:
-					if (AreEqual(Vector3::Dot(n, ray.direction), 0.0f)) return false;
+					hitMask = determinant != zero;
 					break;
 				case TriangleCullMode::FrontFaceCulling:
-					if (Vector3::Dot(n, ray.direction) < 0.0f) return false;
+					hitMask = determinant < zero;
 					break;
 				case TriangleCullMode::BackFaceCulling:
-					if (Vector3::Dot(n, ray.direction) > 0.0f) return false;
+					hitMask = determinant > zero;
 					break;
 			}
 
-			const Vector3 L{ triangle.v0 - ray.origin };
-			const float t{ Vector3::Dot(L, n) / Vector3::Dot(ray.direction, n) };
+			// s = origin - v0, q = s x edge1
+			const Float8 sx{ blockRay.originX - Float8::Load(block.v0x) };
+			const Float8 sy{ blockRay.originY - Float8::Load(block.v0y) };
+			const Float8 sz{ blockRay.originZ - Float8::Load(block.v0z) };
 
-			if (t < ray.min || t > ray.max) return false;
+			const Float8 qx{ sy * edge1z - sz * edge1y };
+			const Float8 qy{ sz * edge1x - sx * edge1z };
+			const Float8 qz{ sx * edge1y - sy * edge1x };
 
-			const Vector3 P{ ray.origin + (ray.direction * t) };
+			// Same unscaled, inclusive tests as the scalar kernel, with the sign of the determinant folded in
+			const Float8 absDeterminant{ Float8::Abs(determinant) };
+			const Float8 u{ Float8::MultiplySign(sx * px + sy * py + sz * pz, determinant) };
+			const Float8 v{ Float8::MultiplySign(blockRay.directionX * qx + blockRay.directionY * qy + blockRay.directionZ * qz, determinant) };
+			const Float8 tScaled{ Float8::MultiplySign(edge2x * qx + edge2y * qy + edge2z * qz, determinant) };
 
-			const Vector3 e0{ triangle.v1 - triangle.v0 };
-			const Vector3 e1{ triangle.v2 - triangle.v1 };
-			const Vector3 e2{ triangle.v0 - triangle.v2 };
+			hitMask = hitMask & (u >= zero) & (v >= zero) & ((u + v) <= absDeterminant)
+				& (tScaled >= Float8::Broadcast(ray.min) * absDeterminant) & (tScaled <= Float8::Broadcast(ray.max) * absDeterminant);
 
-			const Vector3 p0{ P - triangle.v0 };
-			const Vector3 p1{ P - triangle.v1 };
-			const Vector3 p2{ P - triangle.v2 };
+			STATS_ADD(TriangleHits, std::popcount(uint32_t(Float8::MoveMask(hitMask))));
+			return Float8::Select(hitMask, tScaled / absDeterminant, Float8::Broadcast(FLT_MAX));
+		}
 
-			if(Vector3::Dot(Vector3::Cross(e0, p0), n) < 0.0f) return false;
-			if(Vector3::Dot(Vector3::Cross(e1, p1), n) < 0.0f) return false;
-			if(Vector3::Dot(Vector3::Cross(e2, p2), n) < 0.0f) return false;
+		/**
+		 * \param triangleIndex Set to the mesh index of the closest triangle of the block when one is hit
+		 * \return Distance to the closest hit in the block, FLT_MAX when every triangle is missed within [ray.min, ray.max]
+		 */
+		inline float IntersectTriangleBlock(const TriangleBlock& block, TriangleCullMode cullMode, const BlockRay& blockRay, const Ray& ray, uint32_t& triangleIndex)
+		{
+			const Float8 t{ IntersectTriangleBlockLanes(block, cullMode, blockRay, ray) };
+			const float closestT{ Float8::HorizontalMin(t) };
+
+			if (closestT == FLT_MAX) return FLT_MAX;
+
+			triangleIndex = block.triangleIndices[std::countr_zero(Float8::MoveMask(t == Float8::Broadcast(closestT)))];
+
+			return closestT;
+		}
 
-			hitRecord.origin = P;
+		inline bool HitTest_TriangleBlock(const TriangleBlock& block, TriangleCullMode cullMode, const BlockRay& blockRay, const Ray& ray)
+		{
+			return Float8::MoveMask(IntersectTriangleBlockLanes(block, cullMode, blockRay, ray) != Float8::Broadcast(FLT_MAX)) != 0;
+		}
+
+		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
+		{
+			const float t{ IntersectTriangle(triangle.v0, triangle.v1 - triangle.v0, triangle.v2 - triangle.v0, triangle.cullMode, ray) };
+			if (t == FLT_MAX) return false;
+
+			hitRecord.origin = ray.origin + (ray.direction * t);
 			hitRecord.normal = triangle.normal;
 			hitRecord.t = t;
 			hitRecord.didHit = true;
@@ -171,74 +308,929 @@ namespace dae
 
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
 		{
-			const Vector3 a{ triangle.v1 - triangle.v0 };
-			const Vector3 b{ triangle.v2 - triangle.v0 };
-			const Vector3 n{ Vector3::Cross(a, b).Normalized() };
+			// Loose triangles cast shadows with the opposite face culling from the one they are seen with
+			TriangleCullMode cullMode{ triangle.cullMode };
+			if (cullMode == TriangleCullMode::FrontFaceCulling) cullMode = TriangleCullMode::BackFaceCulling;
+			else if (cullMode == TriangleCullMode::BackFaceCulling) cullMode = TriangleCullMode::FrontFaceCulling;
+
+			return IntersectTriangle(triangle.v0, triangle.v1 - triangle.v0, triangle.v2 - triangle.v0, cullMode, ray) != FLT_MAX;
+		}
+
+		/**
+		 * \brief Slab test of a ray against an axis aligned bounding box
+		 * \param inverseDirection Component wise reciprocal of the ray direction, computed once per ray
+		 * \return Distance along the ray where it enters the box, FLT_MAX when the box is missed within [ray.min, ray.max]
+		 */
+		inline float SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, const Vector3& inverseDirection)
+		{
+			const float tx1{ (minAABB.x - ray.origin.x) * inverseDirection.x };
+			const float tx2{ (maxAABB.x - ray.origin.x) * inverseDirection.x };
 
-			switch (triangle.cullMode)
+			float tmin{ std::min(tx1, tx2) };
+			float tmax{ std::max(tx1, tx2) };
+
+			const float ty1{ (minAABB.y - ray.origin.y) * inverseDirection.y };
+			const float ty2{ (maxAABB.y - ray.origin.y) * inverseDirection.y };
+
+			tmin = std::max(tmin, std::min(ty1, ty2));
+			tmax = std::min(tmax, std::max(ty1, ty2));
+
+			const float tz1{ (minAABB.z - ray.origin.z) * inverseDirection.z };
+			const float tz2{ (maxAABB.z - ray.origin.z) * inverseDirection.z };
+
+			tmin = std::max(tmin, std::min(tz1, tz2));
+			tmax = std::min(tmax, std::max(tz1, tz2));
+
+			STATS_INCREMENT(AABBTests);
+			if (tmax >= tmin && tmax >= ray.min && tmin <= ray.max)
+			{
+				STATS_INCREMENT(AABBHits);
+				return tmin;
+			}
+
+			return FLT_MAX;
+		}
+
+		inline Triangle GetMeshTriangle(const TriangleMesh& mesh, const std::vector<Vector3>& positions, const std::vector<Vector3>& normals, uint32_t triangleIndex)
+		{
+			const int index{ int(triangleIndex) * 3 };
+
+			Triangle triangle{ positions[mesh.indices[index]],
+				positions[mesh.indices[index + 1]],
+				positions[mesh.indices[index + 2]],
+				normals[triangleIndex] };
+
+			triangle.cullMode = mesh.cullMode;
+			triangle.materialIndex = mesh.materialIndex;
+
+			return triangle;
+		}
+
+		inline Triangle GetMeshTriangle(const TriangleMesh& mesh, uint32_t triangleIndex)
+		{
+			return GetMeshTriangle(mesh, mesh.transformedPositions, mesh.transformedNormals, triangleIndex);
+		}
+
+		/**
+		 * \brief Front to back closest hit traversal of a BVH
+		 * \param ray Ray that gets shortened every time a closer primitive is found, so farther nodes get culled
+		 * \param intersectLeaf Called as intersectLeaf(nodeIndex, ray), tests the primitives of a leaf and lowers ray.max when one is hit
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseBVHLeaves_ClosestHit(const BVH& bvh, Ray& ray, IntersectLeaf intersectLeaf)
+		{
+			if (bvh.nodes.empty()) return;
+
+			const Vector3 inverseDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+			if (SlabTest_AABB(bvh.nodes[0].minAABB, bvh.nodes[0].maxAABB, ray, inverseDirection) == FLT_MAX) return;
+
+			struct StackEntry
+			{
+				uint32_t nodeIndex;
+				float t;
+			};
+
+			StackEntry stack[64];
+			int stackSize{ 0 };
+			uint32_t nodeIndex{ 0 };
+
+			while (true)
+			{
+				const BVHNode& node{ bvh.nodes[nodeIndex] };
+
+				if (node.IsLeaf())
+				{
+					intersectLeaf(nodeIndex, ray);
+				}
+				else
+				{
+					uint32_t nearIndex{ node.leftFirst };
+					uint32_t farIndex{ node.leftFirst + 1 };
+					float nearT{ SlabTest_AABB(bvh.nodes[nearIndex].minAABB, bvh.nodes[nearIndex].maxAABB, ray, inverseDirection) };
+					float farT{ SlabTest_AABB(bvh.nodes[farIndex].minAABB, bvh.nodes[farIndex].maxAABB, ray, inverseDirection) };
+
+					if (farT < nearT)
+					{
+						std::swap(nearIndex, farIndex);
+						std::swap(nearT, farT);
+					}
+
+					if (nearT != FLT_MAX)
+					{
+						if (farT != FLT_MAX) stack[stackSize++] = StackEntry{ farIndex, farT };
+
+						nodeIndex = nearIndex;
+						continue;
+					}
+				}
+
+				// Pop the next node, skipping the ones that are now farther away than the closest hit
+				while (stackSize > 0 && stack[stackSize - 1].t > ray.max) --stackSize;
+				if (stackSize == 0) break;
+
+				nodeIndex = stack[--stackSize].nodeIndex;
+			}
+		}
+
+		/**
+		 * \param intersectPrimitive Called as intersectPrimitive(primitiveIndex, ray), tests a primitive and lowers ray.max when it is hit
+		 */
+		template<typename IntersectPrimitive>
+		inline void TraverseBVH_ClosestHit(const BVH& bvh, Ray& ray, IntersectPrimitive intersectPrimitive)
+		{
+			TraverseBVHLeaves_ClosestHit(bvh, ray,
+				[&](uint32_t nodeIndex, Ray& currentRay)
+				{
+					const BVHNode& leaf{ bvh.nodes[nodeIndex] };
+
+					for (uint32_t index{ leaf.leftFirst }; index < leaf.leftFirst + leaf.primitiveCount; ++index)
+					{
+						intersectPrimitive(bvh.primitiveIndices[index], currentRay);
+					}
+				}
+			);
+		}
+
+		/**
+		 * \brief Any hit traversal of a BVH, stops at the first leaf that blocks the ray
+		 * \param isLeafOccluded Called as isLeafOccluded(nodeIndex), returns true when a primitive of the leaf blocks the ray
+		 */
+		template<typename IsLeafOccluded>
+		inline bool TraverseBVHLeaves_AnyHit(const BVH& bvh, const Ray& ray, IsLeafOccluded isLeafOccluded)
+		{
+			if (bvh.nodes.empty()) return false;
+
+			const Vector3 inverseDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+
+			// Any hit is enough for an occlusion query, so there is no need to visit the children in order
+			uint32_t stack[64];
+			int stackSize{ 0 };
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const uint32_t nodeIndex{ stack[--stackSize] };
+				const BVHNode& node{ bvh.nodes[nodeIndex] };
+
+				if (SlabTest_AABB(node.minAABB, node.maxAABB, ray, inverseDirection) == FLT_MAX) continue;
+
+				if (node.IsLeaf())
+				{
+					if (isLeafOccluded(nodeIndex)) return true;
+				}
+				else
+				{
+					stack[stackSize++] = node.leftFirst + 1;
+					stack[stackSize++] = node.leftFirst;
+				}
+			}
+
+			return false;
+		}
+
+		/**
+		 * \param isOccluded Called as isOccluded(primitiveIndex), returns true when the primitive blocks the ray
+		 */
+		template<typename IsOccluded>
+		inline bool TraverseBVH_AnyHit(const BVH& bvh, const Ray& ray, IsOccluded isOccluded)
+		{
+			return TraverseBVHLeaves_AnyHit(bvh, ray,
+				[&](uint32_t nodeIndex)
+				{
+					const BVHNode& leaf{ bvh.nodes[nodeIndex] };
+
+					for (uint32_t index{ leaf.leftFirst }; index < leaf.leftFirst + leaf.primitiveCount; ++index)
+					{
+						if (isOccluded(bvh.primitiveIndices[index])) return true;
+					}
+
+					return false;
+				}
+			);
+		}
+
+		// Ray origin and reciprocal direction in every lane, for slab testing the 8 children of a wide BVH node at once
+		struct WideNodeRay
+		{
+			Float8 originX;
+			Float8 originY;
+			Float8 originZ;
+			Float8 inverseDirectionX;
+			Float8 inverseDirectionY;
+			Float8 inverseDirectionZ;
+		};
+
+		inline WideNodeRay BroadcastInverseRay(const Ray& ray)
+		{
+			return WideNodeRay{ Float8::Broadcast(ray.origin.x), Float8::Broadcast(ray.origin.y), Float8::Broadcast(ray.origin.z),
+				Float8::Broadcast(1.0f / ray.direction.x), Float8::Broadcast(1.0f / ray.direction.y), Float8::Broadcast(1.0f / ray.direction.z) };
+		}
+
+		/**
+		 * \brief SlabTest_AABB on all children of a wide BVH node at once
+		 * \param hitBits Set to one bit per child that the ray enters within [ray.min, ray.max]
+		 * \param distances Receives the entry distance of every child
+		 */
+		inline void SlabTest_WideBVHNode(const WideBVHNode& node, const WideNodeRay& wideRay, const Ray& ray, uint32_t& hitBits, float* distances)
+		{
+			const Float8 tx1{ (Float8::Load(node.minX) - wideRay.originX) * wideRay.inverseDirectionX };
+			const Float8 tx2{ (Float8::Load(node.maxX) - wideRay.originX) * wideRay.inverseDirectionX };
+			const Float8 ty1{ (Float8::Load(node.minY) - wideRay.originY) * wideRay.inverseDirectionY };
+			const Float8 ty2{ (Float8::Load(node.maxY) - wideRay.originY) * wideRay.inverseDirectionY };
+			const Float8 tz1{ (Float8::Load(node.minZ) - wideRay.originZ) * wideRay.inverseDirectionZ };
+			const Float8 tz2{ (Float8::Load(node.maxZ) - wideRay.originZ) * wideRay.inverseDirectionZ };
+
+			const Float8 tmin{ Float8::Max(Float8::Max(Float8::Min(tx1, tx2), Float8::Min(ty1, ty2)), Float8::Min(tz1, tz2)) };
+			const Float8 tmax{ Float8::Min(Float8::Min(Float8::Max(tx1, tx2), Float8::Max(ty1, ty2)), Float8::Max(tz1, tz2)) };
+
+			const Float8 hitMask{ (tmax >= tmin) & (tmax >= Float8::Broadcast(ray.min)) & (tmin <= Float8::Broadcast(ray.max)) };
+
+			// Unused lanes hold inverted boxes, which the min/max above would turn back into valid ones
+			hitBits = Float8::MoveMask(hitMask) & ((1u << node.childCount) - 1u);
+			Float8::Store(distances, tmin);
+
+			STATS_ADD(AABBTests, node.childCount);
+			STATS_ADD(AABBHits, std::popcount(hitBits));
+		}
+
+		/**
+		 * \brief Front to back closest hit traversal of a wide BVH, the children of every node are visited nearest first
+		 * \param intersectLeaf Called as intersectLeaf(binaryNodeIndex, ray) with the index of the leaf in the binary BVH the wide one was built from
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseWideBVHLeaves_ClosestHit(const WideBVH& bvh, Ray& ray, IntersectLeaf intersectLeaf)
+		{
+			if (bvh.nodes.empty()) return;
+
+			const Vector3 inverseDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+			if (SlabTest_AABB(bvh.minAABB, bvh.maxAABB, ray, inverseDirection) == FLT_MAX) return;
+
+			const WideNodeRay wideRay{ BroadcastInverseRay(ray) };
+
+			struct StackEntry
+			{
+				uint32_t child;
+				float t;
+			};
+
+			StackEntry stack[512];
+			int stackSize{ 0 };
+			uint32_t child{ 0 };
+
+			while (true)
+			{
+				if (child & WideBVHNode::LeafFlag)
+				{
+					intersectLeaf(child & ~WideBVHNode::LeafFlag, ray);
+				}
+				else
+				{
+					const WideBVHNode& node{ bvh.nodes[child] };
+
+					alignas(32) float distances[WideBVHNode::Width];
+					uint32_t hitBits{};
+					SlabTest_WideBVHNode(node, wideRay, ray, hitBits, distances);
+
+					if (hitBits != 0)
+					{
+						// Push the hit children farthest first and carry on with the nearest one straight away
+						const int firstEntry{ stackSize };
+
+						while (hitBits != 0)
+						{
+							const int lane{ std::countr_zero(hitBits) };
+							hitBits &= hitBits - 1;
+
+							const StackEntry hit{ node.children[lane], distances[lane] };
+
+							int position{ stackSize++ };
+							while (position > firstEntry && stack[position - 1].t < hit.t)
+							{
+								stack[position] = stack[position - 1];
+								--position;
+							}
+							stack[position] = hit;
+						}
+
+						child = stack[--stackSize].child;
+						continue;
+					}
+				}
+
+				// Pop the next child, skipping the ones that are now farther away than the closest hit
+				while (stackSize > 0 && stack[stackSize - 1].t > ray.max) --stackSize;
+				if (stackSize == 0) break;
+
+				child = stack[--stackSize].child;
+			}
+		}
+
+		/**
+		 * \brief Any hit traversal of a wide BVH, stops at the first leaf that blocks the ray
+		 * \param isLeafOccluded Called as isLeafOccluded(binaryNodeIndex), returns true when a primitive of the leaf blocks the ray
+		 */
+		template<typename IsLeafOccluded>
+		inline bool TraverseWideBVHLeaves_AnyHit(const WideBVH& bvh, const Ray& ray, IsLeafOccluded isLeafOccluded)
+		{
+			if (bvh.nodes.empty()) return false;
+
+			const Vector3 inverseDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+			if (SlabTest_AABB(bvh.minAABB, bvh.maxAABB, ray, inverseDirection) == FLT_MAX) return false;
+
+			const WideNodeRay wideRay{ BroadcastInverseRay(ray) };
+
+			uint32_t stack[512];
+			int stackSize{ 0 };
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const uint32_t child{ stack[--stackSize] };
+
+				if (child & WideBVHNode::LeafFlag)
+				{
+					if (isLeafOccluded(child & ~WideBVHNode::LeafFlag)) return true;
+					continue;
+				}
+
+				const WideBVHNode& node{ bvh.nodes[child] };
+
+				alignas(32) float distances[WideBVHNode::Width];
+				uint32_t hitBits{};
+				SlabTest_WideBVHNode(node, wideRay, ray, hitBits, distances);
+
+				while (hitBits != 0)
+				{
+					stack[stackSize++] = node.children[std::countr_zero(hitBits)];
+					hitBits &= hitBits - 1;
+				}
+			}
+
+			return false;
+		}
+
+		/**
+		 * \param normals Face normals in the same space as the BVH and the precomputed triangles, the transformed ones for world space meshes
+		 */
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const std::vector<Vector3>& normals, const Ray& ray, HitRecord& hitRecord)
+		{
+			Ray closestRay{ ray };
+			uint32_t closestIndex{ UINT32_MAX };
+			const BlockRay blockRay{ BroadcastRay(ray) };
+
+			TraverseWideBVHLeaves_ClosestHit(mesh.wideBVH, closestRay,
+				[&](uint32_t nodeIndex, Ray& currentRay)
+				{
+					const uint32_t primitiveCount{ mesh.bvh.nodes[nodeIndex].primitiveCount };
+					const uint32_t firstBlock{ mesh.leafBlockOffsets[nodeIndex] };
+					const uint32_t blockCount{ (primitiveCount + TriangleBlock::Width - 1) / TriangleBlock::Width };
+					STATS_ADD(TriangleTests, primitiveCount);
+
+					for (uint32_t blockIndex{ firstBlock }; blockIndex < firstBlock + blockCount; ++blockIndex)
+					{
+						uint32_t triangleIndex{};
+						const float t{ IntersectTriangleBlock(mesh.triangleBlocks[blockIndex], mesh.cullMode, blockRay, currentRay, triangleIndex) };
+						if (t == FLT_MAX) continue;
+
+						currentRay.max = t;
+						closestIndex = triangleIndex;
+					}
+				}
+			);
+
+			if (closestIndex == UINT32_MAX) return false;
+
+			hitRecord.origin = ray.origin + (ray.direction * closestRay.max);
+			hitRecord.normal = normals[closestIndex];
+			hitRecord.t = closestRay.max;
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = mesh.materialIndex;
+
+			return true;
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			// Mesh triangles are occlusion tested with the same face culling as closest hits
+			const BlockRay blockRay{ BroadcastRay(ray) };
+
+			return TraverseWideBVHLeaves_AnyHit(mesh.wideBVH, ray,
+				[&](uint32_t nodeIndex)
+				{
+					const uint32_t primitiveCount{ mesh.bvh.nodes[nodeIndex].primitiveCount };
+					const uint32_t firstBlock{ mesh.leafBlockOffsets[nodeIndex] };
+					const uint32_t blockCount{ (primitiveCount + TriangleBlock::Width - 1) / TriangleBlock::Width };
+
+					for (uint32_t blockIndex{ firstBlock }; blockIndex < firstBlock + blockCount; ++blockIndex)
+					{
+						STATS_ADD(TriangleTests, std::min(TriangleBlock::Width, primitiveCount - (blockIndex - firstBlock) * TriangleBlock::Width));
+						if (HitTest_TriangleBlock(mesh.triangleBlocks[blockIndex], mesh.cullMode, blockRay, ray)) return true;
+					}
+
+					return false;
+				}
+			);
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord)
+		{
+			return HitTest_TriangleMesh(mesh, mesh.transformedNormals, ray, hitRecord);
+		}
+
+		inline Ray TransformRay(const Ray& ray, const Matrix& transform)
+		{
+			// The direction is deliberately not normalized, that way t is the same in both spaces
+			Ray transformedRay{ transform.TransformPoint(ray.origin), transform.TransformVector(ray.direction) };
+			transformedRay.min = ray.min;
+			transformedRay.max = ray.max;
+
+			return transformedRay;
+		}
+
+		inline bool HitTest_MeshInstance(const MeshInstance& instance, const Ray& ray, HitRecord& hitRecord)
+		{
+			const TriangleMesh& mesh{ *instance.pMesh };
+			HitRecord objectHit{};
+
+			if (!HitTest_TriangleMesh(mesh, mesh.normals, TransformRay(ray, instance.worldToObject), objectHit)) return false;
+
+			// Normals transform with the inverse transpose, which for row vectors means dotting with the rows of the inverse
+			const Vector3 objectNormal{ objectHit.normal };
+
+			hitRecord.origin = ray.origin + (ray.direction * objectHit.t);
+			hitRecord.normal = Vector3{ Vector3::Dot(objectNormal, instance.worldToObject[0]),
+				Vector3::Dot(objectNormal, instance.worldToObject[1]),
+				Vector3::Dot(objectNormal, instance.worldToObject[2]) }.Normalized();
+			hitRecord.t = objectHit.t;
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = instance.materialIndex;
+
+			return true;
+		}
+
+		inline bool HitTest_MeshInstance(const MeshInstance& instance, const Ray& ray)
+		{
+			return HitTest_TriangleMesh(*instance.pMesh, TransformRay(ray, instance.worldToObject));
+		}
+
+		/**
+		 * \brief A RayPacket in registers, with the reciprocal directions for slab tests and the side planes of the frustum around its rays
+		 * max holds the closest hit of every lane so far and is lowered when a primitive is hit, like Ray::max in the single ray traversals
+		 * Inactive lanes start with a max of -FLT_MAX, so every test misses them without checking the active mask
+		 */
+		struct PacketRays
+		{
+			Vector3 origin;
+			Float8 originX;
+			Float8 originY;
+			Float8 originZ;
+			Float8 directionX;
+			Float8 directionY;
+			Float8 directionZ;
+			Float8 inverseDirectionX;
+			Float8 inverseDirectionY;
+			Float8 inverseDirectionZ;
+			Float8 min;
+			Float8 max;
+			uint32_t activeMask;
+			Vector3 frustumCorners[4];	// Corner directions widened a little, in winding order
+			Vector3 frustumNormals[4];	// Planes through the origin with every ray of the packet on their positive side, zero when the packet is too thin to have a frustum
+		};
+
+		inline void UpdatePacketFrustum(PacketRays& packet)
+		{
+			const Vector3 center{ packet.frustumCorners[0] + packet.frustumCorners[1] + packet.frustumCorners[2] + packet.frustumCorners[3] };
+			bool isDegenerate{ false };
+
+			for (uint32_t side{}; side < 4; ++side)
+			{
+				Vector3 normal{ Vector3::Cross(packet.frustumCorners[side], packet.frustumCorners[(side + 1) % 4]) };
+				if (Vector3::Dot(normal, center) < 0.0f) normal = -normal;
+
+				isDegenerate |= (normal.SqrMagnitude() == 0.0f);
+				packet.frustumNormals[side] = normal;
+			}
+
+			// A packet of a single row or column has no volume, zero normals turn the frustum test off instead of culling everything
+			if (isDegenerate)
+			{
+				for (Vector3& normal : packet.frustumNormals) normal = Vector3::Zero;
+			}
+		}
+
+		inline PacketRays LoadRayPacket(const RayPacket& rayPacket)
+		{
+			PacketRays packet{};
+			packet.origin = rayPacket.origin;
+			packet.originX = Float8::Broadcast(rayPacket.origin.x);
+			packet.originY = Float8::Broadcast(rayPacket.origin.y);
+			packet.originZ = Float8::Broadcast(rayPacket.origin.z);
+			packet.directionX = Float8::Load(rayPacket.directionX);
+			packet.directionY = Float8::Load(rayPacket.directionY);
+			packet.directionZ = Float8::Load(rayPacket.directionZ);
+
+			const Float8 one{ Float8::Broadcast(1.0f) };
+			packet.inverseDirectionX = one / packet.directionX;
+			packet.inverseDirectionY = one / packet.directionY;
+			packet.inverseDirectionZ = one / packet.directionZ;
+			packet.min = Float8::Broadcast(rayPacket.min);
+			packet.activeMask = rayPacket.activeMask;
+
+			alignas(32) float max[RayPacket::Width];
+			for (uint32_t lane{}; lane < RayPacket::Width; ++lane) max[lane] = (rayPacket.activeMask & (1u << lane)) ? rayPacket.max : -FLT_MAX;
+			packet.max = Float8::Load(max);
+
+			// Widened by 1% of the packet around its center, so rays on the edge of the frustum never get culled by rounding
+			const uint32_t cornerLanes[4]{ 0, RayPacket::Columns - 1, RayPacket::Width - 1, RayPacket::Width - RayPacket::Columns };
+			Vector3 center{};
+			for (const uint32_t lane : cornerLanes) center += Vector3{ rayPacket.directionX[lane], rayPacket.directionY[lane], rayPacket.directionZ[lane] } * 0.25f;
+
+			for (uint32_t corner{}; corner < 4; ++corner)
+			{
+				const uint32_t lane{ cornerLanes[corner] };
+				const Vector3 direction{ rayPacket.directionX[lane], rayPacket.directionY[lane], rayPacket.directionZ[lane] };
+				packet.frustumCorners[corner] = direction + (direction - center) * 0.01f;
+			}
+
+			UpdatePacketFrustum(packet);
+			return packet;
+		}
+
+		/**
+		 * \brief Moves the packet into another space, like TransformRay the directions are not normalized so the distances carry over
+		 */
+		inline PacketRays TransformPacket(const PacketRays& packet, const Matrix& transform)
+		{
+			PacketRays transformedPacket{ packet };
+			transformedPacket.origin = transform.TransformPoint(packet.origin);
+			transformedPacket.originX = Float8::Broadcast(transformedPacket.origin.x);
+			transformedPacket.originY = Float8::Broadcast(transformedPacket.origin.y);
+			transformedPacket.originZ = Float8::Broadcast(transformedPacket.origin.z);
+
+			const Vector4 axes[3]{ transform[0], transform[1], transform[2] };
+			const auto transformComponent{ [&](int component)
+				{
+					return Float8::Broadcast(axes[0][component]) * packet.directionX + Float8::Broadcast(axes[1][component]) * packet.directionY
+						+ Float8::Broadcast(axes[2][component]) * packet.directionZ;
+				}
+			};
+
+			transformedPacket.directionX = transformComponent(0);
+			transformedPacket.directionY = transformComponent(1);
+			transformedPacket.directionZ = transformComponent(2);
+
+			const Float8 one{ Float8::Broadcast(1.0f) };
+			transformedPacket.inverseDirectionX = one / transformedPacket.directionX;
+			transformedPacket.inverseDirectionY = one / transformedPacket.directionY;
+			transformedPacket.inverseDirectionZ = one / transformedPacket.directionZ;
+
+			for (Vector3& corner : transformedPacket.frustumCorners) corner = transform.TransformVector(corner);
+			UpdatePacketFrustum(transformedPacket);
+
+			return transformedPacket;
+		}
+
+		/**
+		 * \brief Whole packet culling, false when the box lies completely outside one of the side planes of the frustum
+		 */
+		inline bool IsInFrustum(const PacketRays& packet, const Vector3& minAABB, const Vector3& maxAABB)
+		{
+			for (const Vector3& normal : packet.frustumNormals)
+			{
+				// The corner of the box farthest along the normal, when even that one is behind the plane so is the rest of the box
+				const Vector3 farthest{ normal.x > 0.0f ? maxAABB.x : minAABB.x, normal.y > 0.0f ? maxAABB.y : minAABB.y, normal.z > 0.0f ? maxAABB.z : minAABB.z };
+				if (Vector3::Dot(normal, farthest - packet.origin) < 0.0f) return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * \brief Frustum test followed by SlabTest_AABB in every lane
+		 * \return Nearest entry distance of the lanes that hit the box, FLT_MAX when no lane does
+		 */
+		inline float SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const PacketRays& packet)
+		{
+			if (!IsInFrustum(packet, minAABB, maxAABB)) return FLT_MAX;
+
+			const Float8 tx1{ (Float8::Broadcast(minAABB.x) - packet.originX) * packet.inverseDirectionX };
+			const Float8 tx2{ (Float8::Broadcast(maxAABB.x) - packet.originX) * packet.inverseDirectionX };
+			const Float8 ty1{ (Float8::Broadcast(minAABB.y) - packet.originY) * packet.inverseDirectionY };
+			const Float8 ty2{ (Float8::Broadcast(maxAABB.y) - packet.originY) * packet.inverseDirectionY };
+			const Float8 tz1{ (Float8::Broadcast(minAABB.z) - packet.originZ) * packet.inverseDirectionZ };
+			const Float8 tz2{ (Float8::Broadcast(maxAABB.z) - packet.originZ) * packet.inverseDirectionZ };
+
+			const Float8 tmin{ Float8::Max(Float8::Max(Float8::Min(tx1, tx2), Float8::Min(ty1, ty2)), Float8::Min(tz1, tz2)) };
+			const Float8 tmax{ Float8::Min(Float8::Min(Float8::Max(tx1, tx2), Float8::Max(ty1, ty2)), Float8::Max(tz1, tz2)) };
+			const Float8 hitMask{ (tmax >= tmin) & (tmax >= packet.min) & (tmin <= packet.max) };
+
+			STATS_ADD(AABBTests, std::popcount(packet.activeMask));
+			if (Float8::MoveMask(hitMask) == 0) return FLT_MAX;
+
+			STATS_ADD(AABBHits, std::popcount(Float8::MoveMask(hitMask)));
+			return Float8::HorizontalMin(Float8::Select(hitMask, tmin, Float8::Broadcast(FLT_MAX)));
+		}
+
+		/**
+		 * \brief Lowers max in the lanes where t is closer and returns them as one bit per lane
+		 * A tie keeps the primitive that was hit first, like the strict compare in Scene::GetClosestHit does for single rays
+		 */
+		inline uint32_t UpdateClosestHits(PacketRays& packet, const Float8& t)
+		{
+			const Float8 hitMask{ t < packet.max };
+			packet.max = Float8::Select(hitMask, t, packet.max);
+
+			return Float8::MoveMask(hitMask);
+		}
+
+		/**
+		 * \return One bit per lane that hit the sphere closer than its max, which is lowered to the hit
+		 */
+		inline uint32_t HitTest_Sphere(const Sphere& sphere, PacketRays& packet)
+		{
+			for (const Vector3& normal : packet.frustumNormals)
+			{
+				if (Vector3::Dot(normal, sphere.origin - packet.origin) < -sphere.radius * normal.Magnitude()) return 0;
+			}
+
+			STATS_ADD(SphereTests, std::popcount(packet.activeMask));
+
+			// The origin is shared, so C is the same for every lane
+			const Vector3 sphereToOrigin{ packet.origin - sphere.origin };
+			const float C{ Vector3::Dot(sphereToOrigin, sphereToOrigin) - powf(sphere.radius, 2) };
+
+			const Float8 A{ packet.directionX * packet.directionX + packet.directionY * packet.directionY + packet.directionZ * packet.directionZ };
+			const Float8 B{ (Float8::Broadcast(2.0f) * packet.directionX) * Float8::Broadcast(sphereToOrigin.x)
+				+ (Float8::Broadcast(2.0f) * packet.directionY) * Float8::Broadcast(sphereToOrigin.y)
+				+ (Float8::Broadcast(2.0f) * packet.directionZ) * Float8::Broadcast(sphereToOrigin.z) };
+			const Float8 discriminant{ B * B - Float8::Broadcast(4.0f) * A * Float8::Broadcast(C) };
+
+			const Float8 sqrtDiscriminant{ Float8::Sqrt(Float8::Max(discriminant, Float8::Broadcast(0.0f))) };
+			const Float8 twoA{ Float8::Broadcast(2.0f) * A };
+			const Float8 nearT{ (Float8::Broadcast(0.0f) - B - sqrtDiscriminant) / twoA };
+			const Float8 farT{ (Float8::Broadcast(0.0f) - B + sqrtDiscriminant) / twoA };
+			const Float8 t{ Float8::Select(nearT < packet.min, farT, nearT) };
+
+			const Float8 hitMask{ (discriminant > Float8::Broadcast(0.0f)) & (t >= packet.min) & (t <= packet.max) };
+			const uint32_t hitLanes{ UpdateClosestHits(packet, Float8::Select(hitMask, t, Float8::Broadcast(FLT_MAX))) };
+
+			STATS_ADD(SphereHits, std::popcount(hitLanes));
+			return hitLanes;
+		}
+
+		inline uint32_t HitTest_Plane(const Plane& plane, PacketRays& packet)
+		{
+			STATS_ADD(PlaneTests, std::popcount(packet.activeMask));
+
+			const Float8 numerator{ Float8::Broadcast(Vector3::Dot((plane.origin - packet.origin), plane.normal)) };
+			const Float8 denominator{ packet.directionX * Float8::Broadcast(plane.normal.x) + packet.directionY * Float8::Broadcast(plane.normal.y)
+				+ packet.directionZ * Float8::Broadcast(plane.normal.z) };
+			const Float8 t{ numerator / denominator };
+
+			const Float8 hitMask{ (t >= packet.min) & (t <= packet.max) };
+			const uint32_t hitLanes{ UpdateClosestHits(packet, Float8::Select(hitMask, t, Float8::Broadcast(FLT_MAX))) };
+
+			STATS_ADD(PlaneHits, std::popcount(hitLanes));
+			return hitLanes;
+		}
+
+		/**
+		 * \brief IntersectTriangle for every lane of a packet against one triangle, the origin is shared so s, q and the scaled distance are computed once
+		 * \return Distance to the hit per lane, FLT_MAX in the lanes that missed within [min, max]
+		 */
+		inline Float8 IntersectTriangle(const Vector3& v0, const Vector3& edge1, const Vector3& edge2, TriangleCullMode cullMode, const PacketRays& packet)
+		{
+			STATS_ADD(TriangleTests, std::popcount(packet.activeMask));
+			const Vector3 s{ packet.origin - v0 };
+			const Vector3 q{ Vector3::Cross(s, edge1) };
+
+			// p = direction x edge2
+			const Float8 px{ packet.directionY * Float8::Broadcast(edge2.z) - packet.directionZ * Float8::Broadcast(edge2.y) };
+			const Float8 py{ packet.directionZ * Float8::Broadcast(edge2.x) - packet.directionX * Float8::Broadcast(edge2.z) };
+			const Float8 pz{ packet.directionX * Float8::Broadcast(edge2.y) - packet.directionY * Float8::Broadcast(edge2.x) };
+
+			const Float8 determinant{ Float8::Broadcast(edge1.x) * px + Float8::Broadcast(edge1.y) * py + Float8::Broadcast(edge1.z) * pz };
+			const Float8 zero{ Float8::Broadcast(0.0f) };
+
+			Float8 hitMask{};
+			switch (cullMode)
 			{
 				case TriangleCullMode::NoCulling:
-					if (AreEqual(Vector3::Dot(n, ray.direction), 0.0f)) return false;
+					hitMask = determinant != zero;
 					break;
 				case TriangleCullMode::FrontFaceCulling:
-					if (Vector3::Dot(n, ray.direction) > 0.0f) return false;
+					hitMask = determinant < zero;
 					break;
 				case TriangleCullMode::BackFaceCulling:
-					if (Vector3::Dot(n, ray.direction) < 0.0f) return false;
+					hitMask = determinant > zero;
 					break;
 			}
 
-			const Vector3 L{ triangle.v0 - ray.origin };
-			const float t{ Vector3::Dot(L, n) / Vector3::Dot(ray.direction, n) };
+			const Float8 absDeterminant{ Float8::Abs(determinant) };
+			const Float8 u{ Float8::MultiplySign(Float8::Broadcast(s.x) * px + Float8::Broadcast(s.y) * py + Float8::Broadcast(s.z) * pz, determinant) };
+			const Float8 v{ Float8::MultiplySign(packet.directionX * Float8::Broadcast(q.x) + packet.directionY * Float8::Broadcast(q.y) + packet.directionZ * Float8::Broadcast(q.z), determinant) };
+			const Float8 tScaled{ Float8::MultiplySign(Float8::Broadcast(Vector3::Dot(edge2, q)), determinant) };
+
+			hitMask = hitMask & (u >= zero) & (v >= zero) & ((u + v) <= absDeterminant)
+				& (tScaled >= packet.min * absDeterminant) & (tScaled <= packet.max * absDeterminant);
 
-			if (t < ray.min || t > ray.max) return false;
+			STATS_ADD(TriangleHits, std::popcount(Float8::MoveMask(hitMask)));
+			return Float8::Select(hitMask, tScaled / absDeterminant, Float8::Broadcast(FLT_MAX));
+		}
+
+		inline uint32_t HitTest_Triangle(const Triangle& triangle, PacketRays& packet)
+		{
+			return UpdateClosestHits(packet, IntersectTriangle(triangle.v0, triangle.v1 - triangle.v0, triangle.v2 - triangle.v0, triangle.cullMode, packet));
+		}
 
-			const Vector3 P{ ray.origin + (ray.direction * t) };
+		/**
+		 * \brief Front to back closest hit traversal of a BVH for a whole packet, a node is visited when the frustum and at least one lane reach it
+		 * \param intersectLeaf Called as intersectLeaf(nodeIndex, packet), tests the primitives of a leaf and lowers packet.max where they are hit
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseBVHLeaves_ClosestHit(const BVH& bvh, PacketRays& packet, IntersectLeaf intersectLeaf)
+		{
+			if (bvh.nodes.empty()) return;
+			if (SlabTest_AABB(bvh.nodes[0].minAABB, bvh.nodes[0].maxAABB, packet) == FLT_MAX) return;
 
-			const Vector3 e0{ triangle.v1 - triangle.v0 };
-			const Vector3 e1{ triangle.v2 - triangle.v1 };
-			const Vector3 e2{ triangle.v0 - triangle.v2 };
+			struct StackEntry
+			{
+				uint32_t nodeIndex;
+				float t;
+			};
 
-			const Vector3 p0{ P - triangle.v0 };
-			const Vector3 p1{ P - triangle.v1 };
-			const Vector3 p2{ P - triangle.v2 };
+			StackEntry stack[64];
+			int stackSize{ 0 };
+			uint32_t nodeIndex{ 0 };
 
-			if (Vector3::Dot(Vector3::Cross(e0, p0), n) < 0.0f) return false;
-			if (Vector3::Dot(Vector3::Cross(e1, p1), n) < 0.0f) return false;
-			if (Vector3::Dot(Vector3::Cross(e2, p2), n) < 0.0f) return false;
+			while (true)
+			{
+				const BVHNode& node{ bvh.nodes[nodeIndex] };
 
-			return true;
+				if (node.IsLeaf())
+				{
+					intersectLeaf(nodeIndex, packet);
+				}
+				else
+				{
+					uint32_t nearIndex{ node.leftFirst };
+					uint32_t farIndex{ node.leftFirst + 1 };
+					float nearT{ SlabTest_AABB(bvh.nodes[nearIndex].minAABB, bvh.nodes[nearIndex].maxAABB, packet) };
+					float farT{ SlabTest_AABB(bvh.nodes[farIndex].minAABB, bvh.nodes[farIndex].maxAABB, packet) };
+
+					if (farT < nearT)
+					{
+						std::swap(nearIndex, farIndex);
+						std::swap(nearT, farT);
+					}
+
+					if (nearT != FLT_MAX)
+					{
+						if (farT != FLT_MAX) stack[stackSize++] = StackEntry{ farIndex, farT };
+
+						nodeIndex = nearIndex;
+						continue;
+					}
+				}
+
+				// A node is only skipped once it lies behind the closest hit of every lane
+				const float farthestHit{ Float8::HorizontalMax(packet.max) };
+				while (stackSize > 0 && stack[stackSize - 1].t > farthestHit) --stackSize;
+				if (stackSize == 0) break;
+
+				nodeIndex = stack[--stackSize].nodeIndex;
+			}
+		}
+
+		template<typename IntersectPrimitive>
+		inline void TraverseBVH_ClosestHit(const BVH& bvh, PacketRays& packet, IntersectPrimitive intersectPrimitive)
+		{
+			TraverseBVHLeaves_ClosestHit(bvh, packet,
+				[&](uint32_t nodeIndex, PacketRays& currentPacket)
+				{
+					const BVHNode& leaf{ bvh.nodes[nodeIndex] };
+
+					for (uint32_t index{ leaf.leftFirst }; index < leaf.leftFirst + leaf.primitiveCount; ++index)
+					{
+						intersectPrimitive(bvh.primitiveIndices[index], currentPacket);
+					}
+				}
+			);
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		/**
+		 * \brief Front to back closest hit traversal of a wide BVH for a whole packet, the children a lane reaches are visited nearest first
+		 * \param intersectLeaf Called as intersectLeaf(binaryNodeIndex, packet) with the index of the leaf in the binary BVH the wide one was built from
+		 */
+		template<typename IntersectLeaf>
+		inline void TraverseWideBVHLeaves_ClosestHit(const WideBVH& bvh, PacketRays& packet, IntersectLeaf intersectLeaf)
 		{
-			if (!SlabTest_TriangleMesh(mesh, ray)) return false;
+			if (bvh.nodes.empty()) return;
+			if (SlabTest_AABB(bvh.minAABB, bvh.maxAABB, packet) == FLT_MAX) return;
 
-			HitRecord closestHit{};
+			struct StackEntry
+			{
+				uint32_t child;
+				float t;
+			};
+
+			StackEntry stack[512];
+			int stackSize{ 0 };
+			uint32_t child{ 0 };
 
-			for (int index{}; index < mesh.indices.size(); index += 3)
+			while (true)
 			{
-				Triangle triangle{ mesh.transformedPositions[mesh.indices[index]],
-					mesh.transformedPositions[mesh.indices[index + 1]],
-					mesh.transformedPositions[mesh.indices[index + 2]],
-					mesh.transformedNormals[index / 3] };
+				if (child & WideBVHNode::LeafFlag)
+				{
+					intersectLeaf(child & ~WideBVHNode::LeafFlag, packet);
+				}
+				else
+				{
+					const WideBVHNode& node{ bvh.nodes[child] };
+					const int firstEntry{ stackSize };
+
+					// One child at a time with all rays, instead of all children with one ray like SlabTest_WideBVHNode
+					for (uint32_t lane{}; lane < node.childCount; ++lane)
+					{
+						const float t{ SlabTest_AABB(Vector3{ node.minX[lane], node.minY[lane], node.minZ[lane] }, Vector3{ node.maxX[lane], node.maxY[lane], node.maxZ[lane] }, packet) };
+						if (t == FLT_MAX) continue;
+
+						const StackEntry hit{ node.children[lane], t };
+
+						int position{ stackSize++ };
+						while (position > firstEntry && stack[position - 1].t < hit.t)
+						{
+							stack[position] = stack[position - 1];
+							--position;
+						}
+						stack[position] = hit;
+					}
+
+					if (stackSize > firstEntry)
+					{
+						child = stack[--stackSize].child;
+						continue;
+					}
+				}
 
-				triangle.cullMode = mesh.cullMode;
-				triangle.materialIndex = mesh.materialIndex;
+				const float farthestHit{ Float8::HorizontalMax(packet.max) };
+				while (stackSize > 0 && stack[stackSize - 1].t > farthestHit) --stackSize;
+				if (stackSize == 0) break;
 
-				HitTest_Triangle(triangle, ray, hitRecord);
-				if (hitRecord.t < closestHit.t) closestHit = hitRecord;
+				child = stack[--stackSize].child;
 			}
+		}
 
-			hitRecord = closestHit;
+		/**
+		 * \brief Closest hit of a packet against a mesh in the space of its BVH, each triangle of a block is tested against all lanes in turn
+		 * \param triangleIndices Receives the mesh index of the closest triangle in every lane that hit the mesh
+		 * \return One bit per lane that hit the mesh closer than its max
+		 */
+		inline uint32_t HitTest_TriangleMesh(const TriangleMesh& mesh, PacketRays& packet, uint32_t* triangleIndices)
+		{
+			uint32_t hitLanes{};
 
-			return hitRecord.didHit;
+			TraverseWideBVHLeaves_ClosestHit(mesh.wideBVH, packet,
+				[&](uint32_t nodeIndex, PacketRays& currentPacket)
+				{
+					const uint32_t primitiveCount{ mesh.bvh.nodes[nodeIndex].primitiveCount };
+					const uint32_t firstBlock{ mesh.leafBlockOffsets[nodeIndex] };
+
+					for (uint32_t primitive{}; primitive < primitiveCount; ++primitive)
+					{
+						const TriangleBlock& block{ mesh.triangleBlocks[firstBlock + primitive / TriangleBlock::Width] };
+						const uint32_t lane{ primitive % TriangleBlock::Width };
+
+						const Vector3 v0{ block.v0x[lane], block.v0y[lane], block.v0z[lane] };
+						const Vector3 edge1{ block.edge1x[lane], block.edge1y[lane], block.edge1z[lane] };
+						const Vector3 edge2{ block.edge2x[lane], block.edge2y[lane], block.edge2z[lane] };
+
+						uint32_t triangleHits{ UpdateClosestHits(currentPacket, IntersectTriangle(v0, edge1, edge2, mesh.cullMode, currentPacket)) };
+						hitLanes |= triangleHits;
+
+						while (triangleHits != 0)
+						{
+							triangleIndices[std::countr_zero(triangleHits)] = block.triangleIndices[lane];
+							triangleHits &= triangleHits - 1;
+						}
+					}
+				}
+			);
+
+			return hitLanes;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		/**
+		 * \brief Traces the packet through the instanced mesh in object space, the distances in max are the same in both spaces
+		 */
+		inline uint32_t HitTest_MeshInstance(const MeshInstance& instance, PacketRays& packet, uint32_t* triangleIndices)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			PacketRays objectPacket{ TransformPacket(packet, instance.worldToObject) };
+
+			const uint32_t hitLanes{ HitTest_TriangleMesh(*instance.pMesh, objectPacket, triangleIndices) };
+			packet.max = objectPacket.max;
+
+			return hitLanes;
 		}
 	}
 
@@ -279,71 +1271,105 @@ namespace dae
 	{
 		#pragma warning(push)
 		#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		// Parses the lines in [begin, end), face indices are absolute so every chunk of a file can be parsed on its own
+		static void ParseOBJLines(const char* begin, const char* end, std::vector<Vector3>& positions, std::vector<int>& indices)
 		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
+			const char* pLine{ begin };
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
+			while (pLine < end)
 			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
+				const char* pLineEnd{ static_cast<const char*>(std::memchr(pLine, '\n', end - pLine)) };
+				if (!pLineEnd) pLineEnd = end;
+
+				//read the first word of the line
+				while (pLine < pLineEnd && (*pLine == ' ' || *pLine == '\t')) ++pLine;
+				const char* pCommandEnd{ pLine };
+				while (pCommandEnd < pLineEnd && !std::isspace(static_cast<unsigned char>(*pCommandEnd))) ++pCommandEnd;
+				const std::string_view command{ pLine, size_t(pCommandEnd - pLine) };
+
+				char* pNumber{ const_cast<char*>(pCommandEnd) };
+				if (command == "v")
 				{
 					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
+					const float x{ std::strtof(pNumber, &pNumber) };
+					const float y{ std::strtof(pNumber, &pNumber) };
+					const float z{ std::strtof(pNumber, &pNumber) };
 					positions.push_back({ x, y, z });
 				}
-				else if (sCommand == "f")
+				else if (command == "f")
 				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
+					const float i0{ std::strtof(pNumber, &pNumber) };
+					const float i1{ std::strtof(pNumber, &pNumber) };
+					const float i2{ std::strtof(pNumber, &pNumber) };
 
 					indices.push_back((int)i0 - 1);
 					indices.push_back((int)i1 - 1);
 					indices.push_back((int)i2 - 1);
 				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
+				//comments and unknown commands are ignored
 
-				if (file.eof())
-					break;
+				pLine = pLineEnd + 1;
 			}
+		}
 
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
-			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
+		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, ThreadPool* pThreadPool = nullptr)
+		{
+			std::ifstream file(filename, std::ios::binary);
+			if (!file)
+				return false;
 
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
+			const std::string content{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
 
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
+			// Cut the file into chunks that end on a line break, so each thread parses whole lines
+			const size_t chunkCount{ pThreadPool ? size_t(pThreadPool->GetThreadCount()) * 4 : 1 };
+			std::vector<size_t> chunkStarts{ 0 };
+
+			for (size_t chunk{ 1 }; chunk < chunkCount; ++chunk)
+			{
+				const size_t lineBreak{ content.find('\n', std::max(chunkStarts.back(), content.size() * chunk / chunkCount)) };
+				if (lineBreak == std::string::npos) break;
+				chunkStarts.push_back(lineBreak + 1);
+			}
+			chunkStarts.push_back(content.size());
+
+			std::vector<std::vector<Vector3>> chunkPositions(chunkStarts.size() - 1);
+			std::vector<std::vector<int>> chunkIndices(chunkStarts.size() - 1);
 
-				normal.Normalize();
-				if (isnan(normal.x))
+			ParallelFor(pThreadPool, uint32_t(chunkStarts.size() - 1), [&](uint32_t begin, uint32_t end)
 				{
-					int k = 0;
+					for (uint32_t chunk{ begin }; chunk < end; ++chunk)
+					{
+						ParseOBJLines(content.data() + chunkStarts[chunk], content.data() + chunkStarts[chunk + 1], chunkPositions[chunk], chunkIndices[chunk]);
+					}
 				}
+			);
 
-				normals.push_back(normal);
+			for (size_t chunk{}; chunk < chunkPositions.size(); ++chunk)
+			{
+				positions.insert(positions.end(), chunkPositions[chunk].begin(), chunkPositions[chunk].end());
+				indices.insert(indices.end(), chunkIndices[chunk].begin(), chunkIndices[chunk].end());
 			}
 
+			//Precompute normals
+			const size_t firstNormal{ normals.size() };
+			normals.resize(firstNormal + indices.size() / 3);
+
+			ParallelFor(pThreadPool, uint32_t(indices.size() / 3), [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t triangle{ begin }; triangle < end; ++triangle)
+					{
+						const uint32_t i0 = indices[triangle * 3];
+						const uint32_t i1 = indices[triangle * 3 + 1];
+						const uint32_t i2 = indices[triangle * 3 + 2];
+
+						const Vector3 edgeV0V1 = positions[i1] - positions[i0];
+						const Vector3 edgeV0V2 = positions[i2] - positions[i0];
+
+						normals[firstNormal + triangle] = Vector3::Cross(edgeV0V1, edgeV0V2).Normalized();
+					}
+				}, TriangleMesh::TransformGrainSize
+			);
+
 			return true;
 		}
 		#pragma warning(pop)
@@ -1,8 +1,12 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include "Vector3.h"
+#include "SIMD.h"
 
 namespace dae
 {
-	struct Vector3;
+	// Header only like Vector3, the arithmetic runs on one Float4 register (SSE or NEON) where available
 	struct Vector4
 	{
 		float x;
@@ -11,22 +15,101 @@ namespace dae
 		float w;
 
 		Vector4() = default;
-		Vector4(float _x, float _y, float _z, float _w);
-		Vector4(const Vector3& v, float _w);
+		constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+		constexpr Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
 
-		float Magnitude() const;
-		float SqrMagnitude() const;
-		float Normalize();
-		Vector4 Normalized() const;
+		float Magnitude() const
+		{
+			return sqrtf(x * x + y * y + z * z + w * w);
+		}
 
-		static float Dot(const Vector4& v1, const Vector4& v2);
+		constexpr float SqrMagnitude() const
+		{
+			return x * x + y * y + z * z + w * w;
+		}
+
+		float Normalize()
+		{
+			const float m = Magnitude();
+			x /= m;
+			y /= m;
+			z /= m;
+			w /= m;
+
+			return m;
+		}
+
+		Vector4 Normalized() const
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m, w / m };
+		}
+
+		static constexpr float Dot(const Vector4& v1, const Vector4& v2)
+		{
+			return (v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z) + (v1.w * v2.w);
+		}
+
+		Float4 ToFloat4() const { return Float4::Load(&x); }
+		static Vector4 FromFloat4(const Float4& v)
+		{
+			Vector4 result;
+			Float4::Store(&result.x, v);
+			return result;
+		}
 
 		// operator overloading
-		Vector4 operator*(float scale) const;
-		Vector4 operator+(const Vector4& v) const;
-		Vector4 operator-(const Vector4& v) const;
-		Vector4& operator+=(const Vector4& v);
-		float& operator[](int index);
-		float operator[](int index) const;
+		Vector4 operator*(float scale) const
+		{
+			return FromFloat4(ToFloat4() * Float4::Broadcast(scale));
+		}
+
+		Vector4 operator+(const Vector4& v) const
+		{
+			return FromFloat4(ToFloat4() + v.ToFloat4());
+		}
+
+		Vector4 operator-(const Vector4& v) const
+		{
+			return FromFloat4(ToFloat4() - v.ToFloat4());
+		}
+
+		Vector4& operator+=(const Vector4& v)
+		{
+			Float4::Store(&x, ToFloat4() + v.ToFloat4());
+			return *this;
+		}
+
+		constexpr float& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+
+		constexpr float operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
 	};
+
+	inline Vector3::Vector3(const Vector4& v) : x(v.x), y(v.y), z(v.z) {}
+
+	inline Vector4 Vector3::ToPoint4() const
+	{
+		return { x, y, z, 1 };
+	}
+
+	inline Vector4 Vector3::ToVector4() const
+	{
+		return { x, y, z, 0 };
+	}
 }
@@ -1,12 +1,19 @@
-#include <vld.h>
+#if defined(_WIN32)
+	#include <vld.h>
+#endif
 #include <SDL.h>
 #include <SDL_surface.h>
 #include <iostream>
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 
 void ShutDown(SDL_Window* pWindow);
+dae::CameraInput ReadCameraInput();
+void PresentFramebuffer(SDL_Window* pWindow, const dae::Framebuffer& framebuffer);
 
 int main(int argc, char* args[])
 {
@@ -19,11 +26,21 @@ int main(int argc, char* args[])
 
 	// Initialize framework
 	dae::Timer* const pTimer = new dae::Timer();
-	dae::Renderer* const pRenderer = new dae::Renderer(pWindow);
+	dae::Renderer* const pRenderer = new dae::Renderer(width, height);
 	dae::Scene* const pScene = new dae::Scene_W4_ExtraScene();
 	float printTimer{ 0.0f };
 	bool isLooping{ true };
 	bool takeScreenshot{ false };
+	bool presentFrame{ false };
+	uint32_t renderedFrameCount{ 0 };
+	float renderedTileFraction{ 0.0f };
+	bool frameRendered{ false };
+	uint32_t framesToTrace{ 0 };
+#if defined(RAYTRACER_STATS)
+	dae::Stats::FrameStats stats{};
+	uint32_t statsFrameCount{ 0 };
+#endif
+	pScene->SetThreadPool(&pRenderer->GetThreadPool());
 	pScene->Initialize();
 	pTimer->Start();
 
@@ -39,11 +56,18 @@ int main(int argc, char* args[])
 				case SDL_QUIT:
 					isLooping = false;
 					break;
+				case SDL_WINDOWEVENT:
+					if (e.window.event == SDL_WINDOWEVENT_EXPOSED) presentFrame = true;
+					break;
 				case SDL_KEYUP:
 					if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					{
 						takeScreenshot = true;
 					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F1)
+					{
+						dae::Benchmark::MathKernels();
+					}
 					if (e.key.keysym.scancode == SDL_SCANCODE_F2)
 					{
 						pRenderer->ToggleShadows();
@@ -52,30 +76,155 @@ int main(int argc, char* args[])
 					{
 						pRenderer->CycleLigtingMode();
 					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					{
+						pRenderer->ToggleCostHeatmap();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					{
+						pRenderer->ToggleSortedShading();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_P)
+					{
+						pRenderer->TogglePacketTracing();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_V)
+					{
+						pRenderer->ToggleWavefront();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_T)
+					{
+						pRenderer->ToggleDirtyTiles();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_R)
+					{
+						pTimer->ToggleDynamicResolution();
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_B)
+					{
+						dae::Benchmark::PrimaryRays(*pScene, width, height);
+					}
 					if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 					{
 						pTimer->StartBenchmark();
 					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+					{
+						dae::Benchmark::MeshTraversal(*pScene, width, height);
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					{
+						dae::Benchmark::TriangleKernel(*pScene, width / 4, height / 4);
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					{
+						dae::Benchmark::ShadowRays(*pScene, width / 2, height / 2);
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					{
+						dae::Benchmark::TileScheduler(*pRenderer, *pScene);
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					{
+						dae::Benchmark::LightingModes(*pRenderer, *pScene);
+					}
+					if (e.key.keysym.scancode == SDL_SCANCODE_F11 && framesToTrace == 0)
+					{
+						#if defined(RAYTRACER_PROFILING)
+							std::cout << "Tracing the next 10 frames" << std::endl;
+							framesToTrace = 10;
+							dae::Profiler::BeginCapture();
+						#else
+							std::cout << "Profiling zones are compiled out, build with RAYTRACER_PROFILING defined" << std::endl;
+						#endif
+					}
 					break;
 			}
 		}
 
-		pScene->Update(pTimer);
-		pRenderer->SetScene(pScene);
-		pRenderer->Render();
+		{
+			PROFILE_ZONE("Frame");
+			pScene->GetCamera().input = ReadCameraInput();
+			{
+				PROFILE_ZONE("Scene::Update");
+				pScene->Update(pTimer);
+			}
+			pRenderer->SetScene(pScene);
+			pRenderer->SetResolutionScale(pTimer->GetResolutionScale());
+			frameRendered = false;
+
+			// A static scene seen from a camera that did not move keeps its last frame, only the F6 benchmark times every frame regardless
+			if (pRenderer->IsFrameOutdated() || pTimer->IsBenchmarkActive())
+			{
+				pScene->UpdateTopLevelBVH();
+				pRenderer->Render();
+				presentFrame = true;
+				frameRendered = true;
+				++renderedFrameCount;
+				renderedTileFraction += pRenderer->GetRenderedTileFraction();
+			}
+			else
+			{
+				// Sleeps until input arrives, or long enough to still poll held keys at about 60 Hz
+				SDL_WaitEventTimeout(nullptr, 16);
+			}
+
+			if (presentFrame)
+			{
+				PresentFramebuffer(pWindow, pRenderer->GetFramebuffer());
+				presentFrame = false;
+			}
+		}
 		pTimer->Update();
+		// Only frames that drew something say how long drawing takes, the others mostly waited for input
+		if (frameRendered) pTimer->UpdateResolutionScale(pTimer->GetElapsed());
+#if defined(RAYTRACER_STATS)
+		stats += dae::Stats::CollectFrame();
+		++statsFrameCount;
+#endif
+
+		if (framesToTrace > 0 && --framesToTrace == 0)
+		{
+			dae::Profiler::EndCapture();
+			if (dae::Profiler::WriteChromeTrace("RayTracer_Trace.json")) std::cout << "Trace saved to RayTracer_Trace.json" << std::endl;
+			else std::cout << "Something went wrong. Trace not saved!" << std::endl;
+		}
 		printTimer += pTimer->GetElapsed();
 
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS() << " (" << renderedFrameCount << " frames rendered, the others had nothing new to draw, "
+				<< (renderedFrameCount > 0 ? renderedTileFraction * 100.0f / float(renderedFrameCount) : 0.0f) << "% of the tiles per rendered frame)" << std::endl;
+			if (pTimer->IsDynamicResolutionEnabled())
+			{
+				std::cout << "  Dynamic resolution: " << pRenderer->GetRenderWidth() << "x" << pRenderer->GetRenderHeight() << " for a " << pTimer->GetTargetFrameTime() * 1000.0f
+					<< " ms target, full resolution would take about " << pTimer->GetFullResolutionFrameTime() * 1000.0f << " ms" << std::endl;
+			}
+			renderedFrameCount = 0;
+			renderedTileFraction = 0.0f;
+#if defined(RAYTRACER_STATS)
+			dae::Stats::Print(std::cout, stats, statsFrameCount);
+			stats = {};
+			statsFrameCount = 0;
+#endif
+
+			for (const dae::TriangleMesh& mesh : pScene->GetTriangleMeshes())
+			{
+				std::cout << "  BVH refit: " << mesh.bvh.lastRefitTime << " ms, rebuild: " << mesh.bvh.lastBuildTime << " ms, SAH cost: "
+					<< mesh.bvh.cost << " (" << mesh.bvh.buildCost << " after rebuild, " << mesh.bvh.refitCount << " refits since)" << std::endl;
+			}
 		}
 
 		if (takeScreenshot)
 		{
 			if (!pRenderer->SaveBufferToImage()) std::cout << "Screenshot saved!" << std::endl;
 			else std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
+			if (pRenderer->IsCostHeatmapEnabled())
+			{
+				if (pRenderer->SaveCostBuffer("RayTracing_Cost.bin")) std::cout << "Cost buffer saved to RayTracing_Cost.bin" << std::endl;
+				else std::cout << "Something went wrong. Cost buffer not saved!" << std::endl;
+			}
 			takeScreenshot = false;
 		}
 	}
@@ -93,4 +242,36 @@ void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
 	SDL_Quit();
+}
+
+dae::CameraInput ReadCameraInput()
+{
+	dae::CameraInput input{};
+
+	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+	input.moveForward = pKeyboardState[SDL_SCANCODE_W];
+	input.moveBackward = pKeyboardState[SDL_SCANCODE_S];
+	input.moveRight = pKeyboardState[SDL_SCANCODE_D];
+	input.moveLeft = pKeyboardState[SDL_SCANCODE_A];
+
+	const uint32_t mouseState = SDL_GetRelativeMouseState(&input.mouseX, &input.mouseY);
+	input.leftMouseButton = mouseState & SDL_BUTTON_LMASK;
+	input.rightMouseButton = mouseState & SDL_BUTTON_RMASK;
+
+	return input;
+}
+
+void PresentFramebuffer(SDL_Window* pWindow, const dae::Framebuffer& framebuffer)
+{
+	SDL_Surface* pSurface = SDL_GetWindowSurface(pWindow);
+
+	{
+		PROFILE_ZONE("SDL_ConvertPixels");
+		SDL_ConvertPixels(int(framebuffer.width), int(framebuffer.height), SDL_PIXELFORMAT_RGB888, framebuffer.pixels.data(), int(framebuffer.width * sizeof(uint32_t)),
+			pSurface->format->format, pSurface->pixels, pSurface->pitch);
+	}
+	{
+		PROFILE_ZONE("SDL_UpdateWindowSurface");
+		SDL_UpdateWindowSurface(pWindow);
+	}
 }
\ No newline at end of file